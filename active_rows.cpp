@@ -4,62 +4,24 @@
 
 #include "variant_utils.h"
 
-std::vector<std::pair<size_t, size_t>> necessaryAndIncidentalActives(std::vector<SNPSupport> supports)
+//a row which is active but has no support at a SNP has supports on both sides of it, so it is incidental
+std::vector<std::pair<size_t, size_t>> necessaryAndIncidentalActives(const SupportMatrix& supports)
 {
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
-	}
-	maxSNP++;
-	maxRead++;
-	std::vector<std::vector<bool>> used;
-	used.resize(maxSNP);
-	for (size_t i = 0; i < maxSNP; i++)
-	{
-		used[i].resize(maxRead, false);
-	}
-	for (auto x : supports)
-	{
-		used[x.SNPnum][x.readNum] = true;
-	}
+	std::vector<size_t> actives = getActiveCoverage(supports);
+	std::vector<size_t> necessary = getSupportedCoverage(supports);
+	assert(actives.size() == necessary.size());
 	std::vector<std::pair<size_t, size_t>> ret;
-	for (size_t i = 0; i < maxSNP; i++)
+	for (size_t i = 0; i < actives.size(); i++)
 	{
-		ret.emplace_back(0, 0);
-		for (size_t j = 0; j < maxRead; j++)
-		{
-			if (used[i][j])
-			{
-				ret.back().first++;
-				continue;
-			}
-			bool hasLeft = false;
-			for (size_t k = 0; k < i; k++)
-			{
-				if (used[k][j])
-				{
-					hasLeft = true;
-				}
-			}
-			for (size_t k = i+1; k < maxSNP && hasLeft; k++)
-			{
-				if (used[k][j])
-				{
-					ret.back().second++;
-					hasLeft = false;
-				}
-			}
-		}
+		assert(necessary[i] <= actives[i]);
+		ret.emplace_back(necessary[i], actives[i]-necessary[i]);
 	}
 	return ret;
 }
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 	std::vector<std::pair<size_t, size_t>> actives = necessaryAndIncidentalActives(supports);
 	for (size_t i = 0; i < actives.size(); i++)
 	{
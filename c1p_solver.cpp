@@ -185,34 +185,10 @@ SupportRenumbering getSpectralOrdering(const std::vector<SNPSupport>& supports,
 
 double getScore(const std::vector<SNPSupport>& supports)
 {
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
-	}
-	maxRead++;
-	maxSNP++;
-	std::vector<std::pair<size_t, size_t>> rowExtents;
-	rowExtents.resize(maxRead, {-1, 0});
-	for (auto x : supports)
-	{
-		rowExtents[x.readNum].first = std::min(rowExtents[x.readNum].first, x.SNPnum);
-		rowExtents[x.readNum].second = std::max(rowExtents[x.readNum].second, x.SNPnum);
-	}
 	double result = 0;
-	for (size_t i = 0; i < maxSNP; i++)
+	for (auto coverage : getActiveCoverage(supports))
 	{
-		double coverage = 0;
-		for (size_t j = 0; j < maxRead; j++)
-		{
-			if (rowExtents[j].first <= i && rowExtents[j].second >= i)
-			{
-				coverage += 1;
-			}
-		}
-		result += pow(2, coverage);
+		result += pow(2, (double)coverage);
 	}
 	return result;
 }
@@ -8,23 +8,13 @@
 
 #include "variant_utils.h"
 
-std::pair<SupportRenumbering, std::vector<SNPSupport>> mergeSupports(std::vector<SNPSupport> supports)
+std::pair<SupportRenumbering, std::vector<SNPSupport>> mergeSupports(const SupportMatrix& supports)
 {
 	SupportRenumbering renumbering;
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
-	}
-	maxSNP++;
-	maxRead++;
-	renumbering = SupportRenumbering::identity(maxRead, maxSNP);
+	renumbering = SupportRenumbering::identity(supports.numReads(), supports.numSNPs());
 
 	std::cout << "start\n";
-	std::sort(supports.begin(), supports.end(), [](SNPSupport left, SNPSupport right) { return left.SNPnum < right.SNPnum; });
-	std::stable_sort(supports.begin(), supports.end(), [](SNPSupport left, SNPSupport right) { return left.readNum < right.readNum; });
+	//by read, and each read's supports by SNP
 	std::vector<SNPLine> rows = makeLines(supports);
 	std::cout << "made lines\n";
 	size_t lastRead = 0;
@@ -74,7 +64,7 @@ std::pair<SupportRenumbering, std::vector<SNPSupport>> mergeSupports(std::vector
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 	auto merged = mergeSupports(supports);
 //	merged.second = renumberSupports(merged.second, merged.first);
 	writeSupports(merged.second, argv[2]);
@@ -1,28 +1,45 @@
 #include <algorithm>
 #include <iostream>
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <tuple>
 #include <cmath>
 #include <cstring>
 #include <set>
+#include <unordered_map>
+#include <queue>
+#include <limits>
+#include <iterator>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <type_traits>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 #include "variant_utils.h"
 #include "haplotyper.h"
 
+//a parameter of the run on this thread. RunParameters sets it for the calling thread and the pools of a run set it on their workers,
+//so runs with different parameters can go on at the same time on different threads
 template <typename T>
-class AssignOnce
+class RunParameter
 {
 public:
-	AssignOnce() : assigned(false) {};
-	AssignOnce& operator=(const T& v)
+	constexpr RunParameter() : value(), assigned(false) {};
+	RunParameter& operator=(const T& v)
 	{
-		assert(!assigned);
 		value = v;
 		assigned = true;
 		return *this;
 	}
-	operator T()
+	operator T() const
 	{
 		assert(assigned);
 		return value;
@@ -32,8 +49,202 @@ private:
 	bool assigned;
 };
 
-AssignOnce<size_t> k;
-AssignOnce<size_t> log2k;
+thread_local RunParameter<size_t> k;
+thread_local RunParameter<size_t> log2k;
+
+//sets k and log2k on this thread for its lifetime and restores the previous ones after it
+class RunParameters
+{
+public:
+	RunParameters(size_t newK) :
+		oldK(k),
+		oldLog2k(log2k)
+	{
+		set(newK);
+	}
+	~RunParameters()
+	{
+		k = oldK;
+		log2k = oldLog2k;
+	}
+	RunParameters(const RunParameters& second) = delete;
+	RunParameters& operator=(const RunParameters& second) = delete;
+	static void set(size_t newK)
+	{
+		k = newK;
+		//one bit even when k is 1, the packed assignments need a size
+		log2k = std::max(ceil(log2(newK)), 1.0);
+	}
+private:
+	RunParameter<size_t> oldK;
+	RunParameter<size_t> oldLog2k;
+};
+
+//assignments packed with Bits bits each, assignment i in bits [i*Bits, (i+1)*Bits) of the little endian bytes
+//Bits is known at compile time for the common k, 0 means log2k
+template <size_t Bits>
+class AssignmentLayout
+{
+public:
+	static size_t bits()
+	{
+		return Bits > 0 ? Bits : (size_t)log2k;
+	}
+	static size_t get(const unsigned char* data, size_t pos)
+	{
+		size_t bit = pos*bits();
+		size_t value = data[bit/8];
+		if (bit%8+bits() > 8)
+		{
+			value |= (size_t)data[bit/8+1] << 8;
+		}
+		return (value >> (bit%8)) & ((1 << bits())-1);
+	}
+	static void set(unsigned char* data, size_t pos, size_t value)
+	{
+		size_t bit = pos*bits();
+		size_t mask = ((1 << bits())-1) << (bit%8);
+		value <<= bit%8;
+		data[bit/8] = (data[bit/8] & ~mask) | (value & mask);
+		if (bit%8+bits() > 8)
+		{
+			data[bit/8+1] = (data[bit/8+1] & ~(mask >> 8)) | ((value & mask) >> 8);
+		}
+	}
+	//first position where the assignments differ, or size if they are equal
+	static size_t firstDifference(const unsigned char* left, const unsigned char* right, size_t size)
+	{
+		size_t fullBytes = size*bits()/8;
+		size_t byte = 0;
+#ifdef __SSE2__
+		for (; byte+16 <= fullBytes; byte += 16)
+		{
+			__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(left+byte)), _mm_loadu_si128((const __m128i*)(right+byte)));
+			unsigned int mask = _mm_movemask_epi8(equal);
+			if (mask != 0xFFFF)
+			{
+				return differingPosition(left, right, byte+__builtin_ctz(~mask));
+			}
+		}
+#endif
+		for (; byte+8 <= fullBytes; byte += 8)
+		{
+			uint64_t leftWord, rightWord;
+			memcpy(&leftWord, left+byte, 8);
+			memcpy(&rightWord, right+byte, 8);
+			if (leftWord != rightWord)
+			{
+				break;
+			}
+		}
+		for (; byte < fullBytes; byte++)
+		{
+			if (left[byte] != right[byte])
+			{
+				return differingPosition(left, right, byte);
+			}
+		}
+		size_t tailBits = size*bits()%8;
+		if (tailBits > 0)
+		{
+			unsigned char diff = (left[byte] ^ right[byte]) & ((1 << tailBits)-1);
+			if (diff != 0)
+			{
+				return (byte*8+__builtin_ctz(diff))/bits();
+			}
+		}
+		return size;
+	}
+	//lexicographic <
+	static bool less(const unsigned char* left, const unsigned char* right, size_t size)
+	{
+		size_t pos = firstDifference(left, right, size);
+		if (pos == size)
+		{
+			return false;
+		}
+		return get(left, pos) < get(right, pos);
+	}
+	//renumbers the sets in order of first appearance
+	static void unpermutate(unsigned char* data, size_t size, size_t k)
+	{
+		assert(k <= ((size_t)1 << bits()));
+		std::array<unsigned char, 256> mapping;
+		size_t nextNum = 0;
+		std::fill(mapping.begin(), mapping.begin()+k, 255);
+		for (size_t i = 0; i < size && nextNum < k; i++)
+		{
+			size_t value = get(data, i);
+			assert(value < k);
+			if (mapping[value] == 255)
+			{
+				mapping[value] = nextNum;
+				nextNum++;
+			}
+		}
+		bool identity = true;
+		for (size_t i = 0; i < k; i++)
+		{
+			//sets that don't appear keep their number
+			if (mapping[i] == 255)
+			{
+				mapping[i] = i;
+			}
+			identity = identity && mapping[i] == i;
+		}
+		if (identity)
+		{
+			return;
+		}
+		if (bits() == 3 || bits() > 4)
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				set(data, i, mapping[get(data, i)]);
+			}
+			return;
+		}
+		//sets don't cross nibbles, so every byte is remapped with a nibble table
+		std::array<unsigned char, 16> nibbleTable;
+		for (size_t nibble = 0; nibble < 16; nibble++)
+		{
+			nibbleTable[nibble] = 0;
+			for (size_t i = 0; i < 4; i += bits())
+			{
+				nibbleTable[nibble] |= mapping[(nibble >> i) & ((1 << bits())-1)] << i;
+			}
+		}
+		size_t numBytes = (size*bits()+7)/8;
+		size_t byte = 0;
+#ifdef __SSSE3__
+		__m128i table = _mm_loadu_si128((const __m128i*)nibbleTable.data());
+		__m128i lowMask = _mm_set1_epi8(0x0F);
+		for (; byte+16 <= numBytes; byte += 16)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i*)(data+byte));
+			__m128i low = _mm_shuffle_epi8(table, _mm_and_si128(values, lowMask));
+			__m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(values, 4), lowMask));
+			_mm_storeu_si128((__m128i*)(data+byte), _mm_or_si128(low, _mm_slli_epi16(high, 4)));
+		}
+#endif
+		for (; byte < numBytes; byte++)
+		{
+			data[byte] = nibbleTable[data[byte] & 0x0F] | (nibbleTable[data[byte] >> 4] << 4);
+		}
+		//keep the bits after the last assignment zero
+		if (size*bits()%8 != 0)
+		{
+			data[numBytes-1] &= (1 << (size*bits()%8))-1;
+		}
+	}
+private:
+	static size_t differingPosition(const unsigned char* left, const unsigned char* right, size_t byte)
+	{
+		return (byte*8+__builtin_ctz(left[byte] ^ right[byte]))/bits();
+	}
+};
+
+typedef AssignmentLayout<0> RuntimeLayout;
 
 //preserve numbering of overlapping haplotypes
 //eg {0, 1, 2}
@@ -78,131 +289,341 @@ std::vector<size_t> getNumbering(const std::vector<size_t>& left, const std::vec
 	return numbering;
 }
 
-bool setEqual(const std::set<size_t>& left, const std::set<size_t>& right)
+ActiveRowSet::ActiveRowSet() :
+	rows(),
+	bits(),
+	wordRanks(),
+	firstRow(0)
+{
+}
+
+ActiveRowSet::ActiveRowSet(std::vector<uint32_t> rows) :
+	rows(std::move(rows)),
+	bits(),
+	wordRanks(),
+	firstRow(0)
+{
+	for (size_t i = 1; i < this->rows.size(); i++)
+	{
+		assert(this->rows[i-1] < this->rows[i]);
+	}
+}
+
+ActiveRowSet ActiveRowSet::range(size_t start, size_t end)
+{
+	assert(end <= std::numeric_limits<uint32_t>::max());
+	std::vector<uint32_t> rows;
+	rows.reserve(end-start);
+	for (size_t i = start; i < end; i++)
+	{
+		rows.push_back(i);
+	}
+	return ActiveRowSet { std::move(rows) };
+}
+
+size_t ActiveRowSet::size() const
 {
-	if (left.size() != right.size())
+	return rows.size();
+}
+
+uint32_t ActiveRowSet::operator[](size_t index) const
+{
+	assert(index < rows.size());
+	return rows[index];
+}
+
+std::vector<uint32_t>::const_iterator ActiveRowSet::begin() const
+{
+	return rows.begin();
+}
+
+std::vector<uint32_t>::const_iterator ActiveRowSet::end() const
+{
+	return rows.end();
+}
+
+bool ActiveRowSet::operator==(const ActiveRowSet& second) const
+{
+	return rows == second.rows;
+}
+
+bool ActiveRowSet::operator!=(const ActiveRowSet& second) const
+{
+	return !(*this == second);
+}
+
+void ActiveRowSet::buildRankIndex()
+{
+	if (rows.size() == 0 || bits.size() > 0)
+	{
+		return;
+	}
+	firstRow = rows[0];
+	bits.resize((rows.back()-firstRow)/64+1, 0);
+	for (auto x : rows)
+	{
+		bits[(x-firstRow)/64] |= (uint64_t)1 << ((x-firstRow)%64);
+	}
+	wordRanks.resize(bits.size(), 0);
+	for (size_t i = 1; i < bits.size(); i++)
+	{
+		wordRanks[i] = wordRanks[i-1] + __builtin_popcountll(bits[i-1]);
+	}
+}
+
+void ActiveRowSet::clearRankIndex()
+{
+	(std::vector<uint64_t>{}).swap(bits);
+	(std::vector<uint32_t>{}).swap(wordRanks);
+}
+
+bool ActiveRowSet::contains(size_t row) const
+{
+	if (bits.size() == 0)
+	{
+		return std::binary_search(rows.begin(), rows.end(), row);
+	}
+	if (row < firstRow || row-firstRow >= bits.size()*64)
 	{
 		return false;
 	}
-	return std::equal(left.begin(), left.end(), right.begin());
+	return (bits[(row-firstRow)/64] >> ((row-firstRow)%64)) & 1;
 }
 
-std::set<size_t> subsetIndices(const std::set<size_t>& subset, const std::set<size_t>& set)
+size_t ActiveRowSet::rank(size_t row) const
 {
-	auto subsetIter = subset.begin();
-	auto setIter = set.begin();
-	size_t index = 0;
-	std::set<size_t> ret;
-	while (setIter != set.end() && subsetIter != subset.end())
+	assert(contains(row));
+	if (bits.size() == 0)
 	{
-		if (*setIter == *subsetIter)
-		{
-			ret.insert(index);
-			subsetIter++;
-		}
-		setIter++;
-		index++;
+		return std::lower_bound(rows.begin(), rows.end(), row) - rows.begin();
 	}
-	assert(subsetIter == subset.end());
-	return ret;
+	size_t offset = row-firstRow;
+	return wordRanks[offset/64] + __builtin_popcountll(bits[offset/64] & (((uint64_t)1 << (offset%64))-1));
 }
 
-std::set<size_t> setIntersection(const std::set<size_t>& left, const std::set<size_t>& right)
+ActiveRowSet setIntersection(const ActiveRowSet& left, const ActiveRowSet& right)
 {
-	std::set<size_t> ret;
-	std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::inserter(ret, ret.begin()));
-	return ret;
+	std::vector<uint32_t> ret;
+	std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(ret));
+	return ActiveRowSet { std::move(ret) };
 }
 
-std::set<size_t> setUnion(const std::set<size_t>& left, const std::set<size_t>& right)
+std::vector<size_t> subsetIndices(const ActiveRowSet& subset, const ActiveRowSet& set)
 {
-	std::set<size_t> ret;
-	std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::inserter(ret, ret.begin()));
+	std::vector<size_t> ret;
+	ret.reserve(subset.size());
+	for (auto x : subset)
+	{
+		ret.push_back(set.rank(x));
+	}
 	return ret;
 }
 
-int fact(int n)
+template <typename T>
+void clearVector(std::vector<T>& o)
+{
+	(std::vector<T>{}).swap(o);
+}
+
+//keeps the elements at the given indices, which must be in increasing order
+template <typename T>
+void keepIndices(std::vector<T>& o, const std::vector<size_t>& indices)
 {
-	int ret = 1;
-	for (int i = 2; i < n; i++)
+	for (size_t i = 0; i < indices.size(); i++)
 	{
-		ret *= i;
+		assert(i == 0 || indices[i] > indices[i-1]);
+		o[i] = std::move(o[indices[i]]);
 	}
-	return ret;
+	o.resize(indices.size());
 }
 
-TinyVectorMemoryAllocator::~TinyVectorMemoryAllocator()
+size_t saturatingAdd(size_t left, size_t right)
+{
+	return left > std::numeric_limits<size_t>::max()-right ? std::numeric_limits<size_t>::max() : left+right;
+}
+
+size_t saturatingMultiply(size_t left, size_t right)
+{
+	return right != 0 && left > std::numeric_limits<size_t>::max()/right ? std::numeric_limits<size_t>::max() : left*right;
+}
+
+//number of partitions of coverage rows into at most k sets, the sum of the Stirling numbers of the second kind S(coverage, 1..k)
+//saturates at the maximum size_t
+size_t getNumberOfPartitions(size_t coverage, size_t k)
 {
-	if (memory != nullptr)
+	if (coverage == 0)
+	{
+		return 1;
+	}
+	//stirling[j] is S(n, j) for the current n
+	std::vector<size_t> stirling;
+	stirling.resize(k+1, 0);
+	stirling[0] = 1;
+	for (size_t n = 1; n <= coverage; n++)
+	{
+		for (size_t j = std::min(n, k); j > 0; j--)
+		{
+			stirling[j] = saturatingAdd(saturatingMultiply(j, stirling[j]), stirling[j-1]);
+		}
+		stirling[0] = 0;
+	}
+	size_t ret = 0;
+	for (size_t j = 1; j <= k; j++)
 	{
-		delete [] memory;
+		ret = saturatingAdd(ret, stirling[j]);
 	}
+	return ret;
+}
+
+TinyVectorMemoryAllocator::Slab::Slab(size_t size) :
+	memory(new unsigned char[size]),
+	size(size),
+	used(0)
+{
+}
+
+TinyVectorMemoryAllocator::TinyVectorMemoryAllocator() :
+	TinyVectorMemoryAllocator(defaultSlabSize)
+{
+}
+
+TinyVectorMemoryAllocator::TinyVectorMemoryAllocator(size_t slabSize) :
+	slabs(),
+	largeSlabs(),
+	currentIndex(0),
+	current(nullptr),
+	growMutex(),
+	slabSize(slabSize),
+	peak(0)
+{
+	assert(slabSize > 0);
+}
+
+TinyVectorMemoryAllocator::~TinyVectorMemoryAllocator()
+{
 }
 
 TinyVectorMemoryAllocator::TinyVectorMemoryAllocator(TinyVectorMemoryAllocator&& second) :
-	bytesPerVector(second.bytesPerVector),
-	nextEmpty(second.nextEmpty),
-	memory(second.memory),
-	size(second.size)
+	slabs(std::move(second.slabs)),
+	largeSlabs(std::move(second.largeSlabs)),
+	currentIndex(second.currentIndex),
+	current(second.current.load()),
+	growMutex(),
+	slabSize(second.slabSize),
+	peak(second.peak)
 {
-	second.memory = nullptr;
+	second.empty();
 }
 
 TinyVectorMemoryAllocator& TinyVectorMemoryAllocator::operator=(TinyVectorMemoryAllocator&& second)
 {
-	if (memory != nullptr)
+	if (this == &second)
+	{
+		return *this;
+	}
+	slabs = std::move(second.slabs);
+	largeSlabs = std::move(second.largeSlabs);
+	currentIndex = second.currentIndex;
+	current = second.current.load();
+	slabSize = second.slabSize;
+	peak = second.peak;
+	second.empty();
+	return *this;
+}
+
+unsigned char* TinyVectorMemoryAllocator::allocate(size_t allocateSize)
+{
+	if (allocateSize > slabSize)
+	{
+		std::lock_guard<std::mutex> lock { growMutex };
+		largeSlabs.emplace_back(new Slab { allocateSize });
+		largeSlabs.back()->used = allocateSize;
+		return largeSlabs.back()->memory.get();
+	}
+	while (true)
+	{
+		Slab* slab = current.load(std::memory_order_acquire);
+		if (slab != nullptr)
+		{
+			//a slab is full once an allocation overshoots it, the overshoot is never handed out
+			size_t start = slab->used.fetch_add(allocateSize, std::memory_order_relaxed);
+			if (start+allocateSize <= slab->size)
+			{
+				return slab->memory.get()+start;
+			}
+		}
+		nextSlab(slab);
+	}
+}
+
+void TinyVectorMemoryAllocator::nextSlab(Slab* full)
+{
+	std::lock_guard<std::mutex> lock { growMutex };
+	//another thread already moved past the full slab
+	if (current.load(std::memory_order_relaxed) != full)
+	{
+		return;
+	}
+	if (full != nullptr)
+	{
+		currentIndex++;
+	}
+	if (currentIndex == slabs.size())
 	{
-		delete [] memory;
+		slabs.emplace_back(new Slab { slabSize });
 	}
-	memory = second.memory;
-	bytesPerVector = second.bytesPerVector;
-	nextEmpty = second.nextEmpty;
-	size = second.size;
-	second.memory = nullptr;
+	assert(slabs[currentIndex]->used == 0);
+	current.store(slabs[currentIndex].get(), std::memory_order_release);
 }
 
-size_t getApproxNumberOfPartitions(size_t coverage, size_t k)
+void TinyVectorMemoryAllocator::reset()
 {
-	return ceil((double)pow(k, coverage)/(double)fact(k))+k;
+	peak = std::max(peak, usedBytes());
+	for (auto& slab : slabs)
+	{
+		slab->used = 0;
+	}
+	largeSlabs.clear();
+	currentIndex = 0;
+	current = slabs.size() > 0 ? slabs[0].get() : nullptr;
 }
 
-TinyVectorMemoryAllocator::TinyVectorMemoryAllocator(size_t coverage, size_t length, size_t k) :
-	bytesPerVector(0),
-	nextEmpty(0),
-	memory(nullptr),
-	size(0)
+void TinyVectorMemoryAllocator::empty()
 {
-	size_t numOfVectors = getApproxNumberOfPartitions(coverage, k);
-	bytesPerVector = (length*ceil(log2(k))+7)/8;
-	size = numOfVectors*bytesPerVector;
-	memory = new unsigned char[size];
-	memset(memory, 0, size);
-//	memory.resize(size, 0);
-	nextEmpty = 0;
+	peak = std::max(peak, usedBytes());
+	slabs.clear();
+	largeSlabs.clear();
+	currentIndex = 0;
+	current = nullptr;
 }
 
-unsigned char* TinyVectorMemoryAllocator::allocate(size_t allocateSize)
+size_t TinyVectorMemoryAllocator::usedBytes() const
 {
-	assert(memory != nullptr);
-//	assert(size == bytesPerVector);
-	if (nextEmpty+allocateSize > size)
+	size_t ret = 0;
+	for (size_t i = 0; i < slabs.size() && i <= currentIndex; i++)
 	{
-		std::ofstream file{"temp.temp"};
-		int a = 1;
-		int b = allocateSize+a;
-		auto c = memory+b;
+		ret += std::min(slabs[i]->used.load(), slabs[i]->size);
+	}
+	for (const auto& slab : largeSlabs)
+	{
+		ret += slab->size;
 	}
-	assert(nextEmpty+allocateSize <= size);
-	unsigned char* ret = memory+nextEmpty;
-	nextEmpty += allocateSize;
 	return ret;
 }
 
-void TinyVectorMemoryAllocator::empty()
+size_t TinyVectorMemoryAllocator::peakBytes() const
+{
+	return std::max(peak, usedBytes());
+}
+
+size_t TinyVectorMemoryAllocator::reservedBytes() const
 {
-	delete [] memory;
-	memory = nullptr;
-//	(std::vector<unsigned char>{}).swap(memory);
+	size_t ret = slabs.size()*slabSize;
+	for (const auto& slab : largeSlabs)
+	{
+		ret += slab->size;
+	}
+	return ret;
 }
 
 SparsePartition::SparsePartition() :
@@ -215,27 +636,17 @@ SparsePartition::SparsePartition(SolidPartition inner) :
 {
 }
 
-size_t SparsePartition::getAssignment(size_t loc, const std::set<size_t>& actives) const
+size_t SparsePartition::getAssignment(size_t loc, const ActiveRowSet& actives) const
 {
 	assert(actives.size() == inner.assignments.size());
-	size_t index = 0;
-	auto iter = actives.begin();
-	while (*iter != loc)
-	{
-		assert(iter != actives.end());
-		assert(index < inner.assignments.size());
-		iter++;
-		index++;
-		assert(iter != actives.end());
-		assert(index < inner.assignments.size());
-	}
+	size_t index = actives.rank(loc);
 	assert(index < inner.assignments.size());
 	return inner.assignments[index];
 }
 
-std::vector<SparsePartition> SparsePartition::getAllPartitions(std::set<size_t> actives, TinyVectorMemoryAllocator& allocator)
+std::vector<SparsePartition> SparsePartition::getAllPartitions(const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator, ThreadPool& pool)
 {
-	std::vector<SolidPartition> solids = SolidPartition::getAllPartitions(0, actives.size(), allocator);
+	std::vector<SolidPartition> solids = SolidPartition::getAllPartitions(0, actives.size(), allocator, pool);
 	std::vector<SparsePartition> ret;
 	for (size_t i = 0; i < solids.size()/2; i++)
 	{
@@ -251,7 +662,7 @@ std::vector<SparsePartition> SparsePartition::getAllPartitions(std::set<size_t>
 	return ret;
 }
 
-SolidPartition SparsePartition::getSolidFromIndices(const std::set<size_t>& pickThese, TinyVectorMemoryAllocator& allocator) const
+SolidPartition SparsePartition::getSolidFromIndices(const std::vector<size_t>& pickThese, TinyVectorMemoryAllocator& allocator) const
 {
 	assert(pickThese.size() > 0);
 	SolidPartition ret;
@@ -270,19 +681,15 @@ SolidPartition SparsePartition::getSolidFromIndices(const std::set<size_t>& pick
 	return ret;
 }
 
-SolidPartition SparsePartition::getSolid(const std::set<size_t>& actives, TinyVectorMemoryAllocator& allocator) const
+SolidPartition SparsePartition::getSolid(const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator) const
 {
-	size_t min = *actives.lower_bound(0);
-	size_t max = *actives.upper_bound(-1);
-	for (size_t i = *actives.lower_bound(0); i < *actives.upper_bound(-1); i++)
-	{
-		assert(actives.count(i) == 1);
-	}
+	assert(actives.size() > 0);
+	assert(actives[actives.size()-1]-actives[0]+1 == actives.size());
 	SolidPartition subset = getSubset(actives, actives, allocator);
 	return subset;
 }
 
-double SparsePartition::deltaCost(const Column& col, const std::set<size_t>& actives) const
+double SparsePartition::deltaCost(const Column& col, const ActiveRowSet& actives) const
 {
 	std::vector<std::array<double, 4>> costs;
 	std::vector<double> costSum;
@@ -295,7 +702,8 @@ double SparsePartition::deltaCost(const Column& col, const std::set<size_t>& act
 		size_t assignment = inner.assignments[index];
 		assert(assignment < costs.size());
 		assert(assignment < costSum.size());
-		size_t columnIndex = *iter;
+		assert(*iter >= col.minRow);
+		size_t columnIndex = *iter-col.minRow;
 		assert(columnIndex < col.costs.size());
 		switch(col.variants[columnIndex])
 		{
@@ -329,42 +737,182 @@ double SparsePartition::deltaCost(const Column& col, const std::set<size_t>& act
 	return totalCost;
 }
 
-SolidPartition SparsePartition::getSubset(const std::set<size_t>& subset, const std::set<size_t>& actives, TinyVectorMemoryAllocator& allocator) const
-{
-	assert(subset.size() > 0);
-	SolidPartition ret;
-	ret.assignments.reserve(subset.size(), allocator);
-#ifndef NDEBUG
-	ret.assignments.actualSize = subset.size();
-#endif
-	size_t num = 0;
-	for (auto x : subset)
-	{
-		assert(num < subset.size());
-		assert(num < ret.assignments.size());
-		assert(getAssignment(x, actives) < k);
-		ret.assignments[num] = getAssignment(x, actives);
-		num++;
-	}
-	assert(num == subset.size());
-	return ret;
-}
-
-
-SolidPartition::SolidPartition() : assignments() {}
-
-PartitionAssignments::PartitionAssignmentElement::PartitionAssignmentElement(PartitionAssignments& container, size_t pos) :
-	container(container),
-	pos(pos)
+//maximal run of consecutive columns with the same active rows, evaluated as one weighted super-column
+class ColumnRun
 {
-}
+public:
+	size_t firstSNP;
+	size_t lastSNP;
+	ActiveRowSet actives;
+	std::vector<Column> columns;
+};
 
-namespace std
+//evaluates the sum of SparsePartition::deltaCost over the columns of a run for a sequence of partitions of the run's rows
+//consecutive partitions usually share a long prefix, so only the rows after the first difference are re-added
+//changes are undone by restoring the old values instead of subtracting, so the costs are exactly the same as deltaCost's
+template <typename Layout>
+class ColumnCostEvaluator
 {
-	template <>
-	void iter_swap(PartitionAssignments::iterator<PartitionAssignments::PartitionAssignmentElement> left, PartitionAssignments::iterator<PartitionAssignments::PartitionAssignmentElement> right)
+public:
+	ColumnCostEvaluator(const ColumnRun& run, size_t k);
+	double deltaCost(const SparsePartition& partition);
+private:
+	struct Weight
 	{
-		size_t value = *left;
+		size_t column;
+		unsigned char variant;
+		double cost;
+	};
+	struct UndoEntry
+	{
+		size_t index;
+		double oldCost;
+		double oldCostSum;
+	};
+	//weights of the supported variants per row, rows in order of the active rows
+	//undo holds one entry per applied weight, so rowStarts are also where the rows start in undo
+	std::vector<Weight> weights;
+	std::vector<size_t> rowStarts;
+	//costs[(column*k+assignment)*4+variant], costSum[column*k+assignment]
+	std::vector<double> costs;
+	std::vector<double> costSum;
+	std::vector<UndoEntry> undo;
+	SolidPartition previous;
+	bool hasPrevious;
+	size_t numColumns;
+	size_t k;
+};
+
+template <typename Layout>
+ColumnCostEvaluator<Layout>::ColumnCostEvaluator(const ColumnRun& run, size_t k) :
+	weights(),
+	rowStarts(),
+	costs(),
+	costSum(),
+	undo(),
+	previous(),
+	hasPrevious(false),
+	numColumns(run.columns.size()),
+	k(k)
+{
+	rowStarts.reserve(run.actives.size()+1);
+	for (auto x : run.actives)
+	{
+		rowStarts.push_back(weights.size());
+		for (size_t c = 0; c < run.columns.size(); c++)
+		{
+			const Column& col = run.columns[c];
+			assert(x >= col.minRow);
+			assert(x-col.minRow < col.costs.size());
+			switch(col.variants[x-col.minRow])
+			{
+				case 'A':
+					weights.push_back({c, 0, col.costs[x-col.minRow]});
+					break;
+				case 'T':
+					weights.push_back({c, 1, col.costs[x-col.minRow]});
+					break;
+				case 'C':
+					weights.push_back({c, 2, col.costs[x-col.minRow]});
+					break;
+				case 'G':
+					weights.push_back({c, 3, col.costs[x-col.minRow]});
+					break;
+				default:
+					break;
+			}
+		}
+	}
+	rowStarts.push_back(weights.size());
+	undo.reserve(weights.size());
+	costs.resize(numColumns*k*4, 0);
+	costSum.resize(numColumns*k, 0);
+}
+
+template <typename Layout>
+double ColumnCostEvaluator<Layout>::deltaCost(const SparsePartition& partition)
+{
+	size_t size = rowStarts.size()-1;
+#ifndef NDEBUG
+	assert(partition.inner.assignments.size() == size);
+#endif
+	size_t keep = 0;
+	if (hasPrevious)
+	{
+		keep = Layout::firstDifference(previous.assignments.rawData(), partition.inner.assignments.rawData(), size);
+		while (undo.size() > rowStarts[keep])
+		{
+			UndoEntry entry = undo.back();
+			undo.pop_back();
+			costs[entry.index*4+weights[undo.size()].variant] = entry.oldCost;
+			costSum[entry.index] = entry.oldCostSum;
+		}
+	}
+	const unsigned char* assignments = partition.inner.assignments.rawData();
+	for (size_t i = keep; i < size; i++)
+	{
+		size_t assignment = Layout::get(assignments, i);
+		assert(assignment < k);
+		assert(rowStarts[i] == undo.size());
+		for (size_t w = rowStarts[i]; w < rowStarts[i+1]; w++)
+		{
+			size_t index = weights[w].column*k+assignment;
+			undo.push_back({index, costs[index*4+weights[w].variant], costSum[index]});
+			costs[index*4+weights[w].variant] += weights[w].cost;
+			costSum[index] += weights[w].cost;
+		}
+	}
+	previous = partition.inner;
+	hasPrevious = true;
+	double result = 0;
+	for (size_t c = 0; c < numColumns; c++)
+	{
+		size_t totalCost = 0;
+		for (size_t i = c*k; i < (c+1)*k; i++)
+		{
+			totalCost += costSum[i]-std::max(std::max(costs[i*4], costs[i*4+1]), std::max(costs[i*4+2], costs[i*4+3]));
+		}
+		result += totalCost;
+	}
+	return result;
+}
+
+SolidPartition SparsePartition::getSubset(const ActiveRowSet& subset, const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator) const
+{
+	assert(subset.size() > 0);
+	SolidPartition ret;
+	ret.assignments.reserve(subset.size(), allocator);
+#ifndef NDEBUG
+	ret.assignments.actualSize = subset.size();
+#endif
+	size_t num = 0;
+	for (auto x : subset)
+	{
+		assert(num < subset.size());
+		assert(num < ret.assignments.size());
+		assert(getAssignment(x, actives) < k);
+		ret.assignments[num] = getAssignment(x, actives);
+		num++;
+	}
+	assert(num == subset.size());
+	return ret;
+}
+
+
+SolidPartition::SolidPartition() : assignments() {}
+
+PartitionAssignments::PartitionAssignmentElement::PartitionAssignmentElement(PartitionAssignments& container, size_t pos) :
+	container(container),
+	pos(pos)
+{
+}
+
+namespace std
+{
+	template <>
+	void iter_swap(PartitionAssignments::iterator<PartitionAssignments::PartitionAssignmentElement> left, PartitionAssignments::iterator<PartitionAssignments::PartitionAssignmentElement> right)
+	{
+		size_t value = *left;
 		*left = (size_t)*right;
 		*right = value;
 	}
@@ -380,34 +928,8 @@ void swap(PartitionAssignments::PartitionAssignmentElement& left, PartitionAssig
 
 size_t PartitionAssignments::PartitionAssignmentElement::getValue() const
 {
-	size_t bytePos = pos*log2k/8;
-	size_t bitPos = (pos*log2k)%8;
-	assert(container.data.size() > bytePos);
-	size_t ret = 0;
-	unsigned char mask;
-	mask = 255-((1<<(bitPos))-1);
-	ret = container.data[bytePos] & mask;
-	ret >>= bitPos;
-	if (bitPos+log2k <= 8)
-	{
-		ret &= (1<<(log2k))-1;
-		return ret;
-	}
-	assert(bitPos < 8);
-	size_t bitsEaten = 8-bitPos;
-	for (; bitsEaten+8 <= log2k; bitsEaten += 8)
-	{
-		bytePos++;
-		assert(bytePos < container.data.size());
-		ret += ((size_t)container.data[bytePos]) << bitsEaten;
-	}
-	if (bitsEaten < log2k)
-	{
-		bytePos++;
-		assert(bytePos < container.data.size());
-		ret += ((size_t)(container.data[bytePos]&((1<<(log2k-bitsEaten))-1))) << bitsEaten;
-	}
-	return ret;
+	assert(container.data.size() > pos*log2k/8);
+	return RuntimeLayout::get(container.data.data(), pos);
 }
 
 PartitionAssignments::PartitionAssignmentElement::operator size_t() const
@@ -434,41 +956,10 @@ PartitionAssignments::PartitionAssignmentElement& PartitionAssignments::Partitio
 {
 	assert(k > 0);
 	assert(log2k > 0);
-	size_t bytePos = ((pos)*log2k)/8;
-	size_t bitPos = ((pos)*log2k)%8;
-	if (container.data.size() <= bytePos)
-	{
-		int a = 1;
-	}
-	assert(container.data.size() > bytePos);
-	for (size_t i = 0; i < log2k; i++)
-	{
-		assert(bytePos < container.data.size());
-		if (value & 1)
-		{
-			container.data[bytePos] |= 1<<bitPos;
-		}
-		else
-		{
-			container.data[bytePos] &= (-1) ^ (1<<bitPos);
-		}
-		value >>= 1;
-		if (i == log2k-1)
-		{
-			break;
-		}
-		bitPos++;
-		if (bitPos >= 8)
-		{
-			bitPos = 0;
-			bytePos++;
-		}
-	}
-	if (container.data.size() <= bytePos)
-	{
-		int a = 1;
-	}
-	assert(container.data.size() > bytePos);
+	assert(log2k <= 8);
+	assert(value < k);
+	assert(container.data.size() > (pos*log2k+log2k-1)/8);
+	RuntimeLayout::set(container.data.data(), pos, value);
 	return *this;
 }
 
@@ -546,6 +1037,21 @@ void PartitionAssignments::reserve(size_t newSize, TinyVectorMemoryAllocator& al
 	extendCapacity(newSize, 0, allocator);
 }
 
+size_t PartitionAssignments::firstDifference(const PartitionAssignments& second, size_t size) const
+{
+	return RuntimeLayout::firstDifference(data.data(), second.data.data(), size);
+}
+
+unsigned char* PartitionAssignments::rawData()
+{
+	return data.data();
+}
+
+const unsigned char* PartitionAssignments::rawData() const
+{
+	return data.data();
+}
+
 PartitionAssignments::PartitionAssignmentElement PartitionAssignments::operator[](size_t pos)
 {
 	assert(pos < size());
@@ -558,94 +1064,302 @@ PartitionAssignments::PartitionAssignmentElementConst PartitionAssignments::oper
 	return PartitionAssignmentElementConst(*this, pos);
 }
 
+//checkpoint contents, in the machine's byte order. vectors are written as their size and then their elements
+class BinaryWriter
+{
+public:
+	template <typename T>
+	void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "");
+		const char* start = reinterpret_cast<const char*>(&value);
+		bytes.insert(bytes.end(), start, start+sizeof(T));
+	}
+	template <typename T>
+	void write(const std::vector<T>& values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "");
+		write((uint64_t)values.size());
+		const char* start = reinterpret_cast<const char*>(values.data());
+		bytes.insert(bytes.end(), start, start+values.size()*sizeof(T));
+	}
+	std::vector<char> bytes;
+};
+
+//reads what BinaryWriter wrote. reading past the end returns zeros and clears good
+class BinaryReader
+{
+public:
+	BinaryReader(std::vector<char> bytes) :
+		bytes(std::move(bytes)),
+		position(0),
+		ok(true)
+	{
+	}
+	template <typename T>
+	T read()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "");
+		T value;
+		memset(&value, 0, sizeof(T));
+		if (!take(sizeof(T)))
+		{
+			return value;
+		}
+		memcpy(&value, bytes.data()+position-sizeof(T), sizeof(T));
+		return value;
+	}
+	template <typename T>
+	std::vector<T> readVector()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "");
+		uint64_t size = read<uint64_t>();
+		std::vector<T> values;
+		if (size > (bytes.size()-position)/sizeof(T) || !take(size*sizeof(T)))
+		{
+			ok = false;
+			return values;
+		}
+		values.resize(size);
+		memcpy(values.data(), bytes.data()+position-size*sizeof(T), size*sizeof(T));
+		return values;
+	}
+	bool good() const
+	{
+		return ok;
+	}
+private:
+	bool take(size_t size)
+	{
+		if (!ok || bytes.size()-position < size)
+		{
+			ok = false;
+			return false;
+		}
+		position += size;
+		return true;
+	}
+	std::vector<char> bytes;
+	size_t position;
+	bool ok;
+};
+
+//traceback of the optimal partitions. every column with new rows gets a block with one node per partition of that column,
+//holding the assignments of the new rows packed into bytes and the index of the node it extends in the previous block.
+//nodes are reference counted by their children and the current partitions and blocks are compacted when half of their nodes are dead
+//the SNPs and rows are counted from the first ones added, so a traceback restarted after a column without overlap only holds the columns since the restart
 class SparsePartitionContainer
 {
 public:
-	SparsePartitionContainer(const std::vector<std::set<size_t>>& readsPerSNP, size_t k);
-	size_t insertPartition(const SparsePartition& partition, size_t SNPnum, size_t size);
-	size_t extendPartition(size_t partitionNum, const SparsePartition& extension, size_t SNPnum, size_t maxSNP, const std::set<size_t>& oldActives, const std::set<size_t>& partitionActives, const std::set<size_t>& intersection);
-	SparsePartition getPartition(size_t partitionNum, size_t maxSNP, TinyVectorMemoryAllocator& allocator) const;
-	void clearUnused(std::vector<size_t> used);
-	void reserveMore(size_t moreIndices);
+	SparsePartitionContainer(size_t k);
+	//SNPs must be added in order before partitions are inserted or extended in them. SNPs which aren't added have no new rows
+	void addSNP(size_t SNPnum, const ActiveRowSet& reads);
+	//makes room for numPartitions nodes in SNPnum, node i is then written by the insertion or extension with node i
+	//nothing is stored for a SNP without new rows, extensions in it return the partition they extend
+	void startSNP(size_t SNPnum, size_t numPartitions);
+	size_t insertPartition(const SparsePartition& partition, size_t SNPnum, size_t size, size_t node);
+	//numOldActives is the number of rows in the columns before SNPnum
+	//different nodes can be written by several threads at the same time
+	size_t extendPartition(size_t partitionNum, const SparsePartition& extension, size_t SNPnum, size_t maxSNP, size_t numOldActives, const ActiveRowSet& partitionActives, const ActiveRowSet& intersection, size_t node);
+	//sets result[row] for every row added since the last restart, result grows to fit them
+	void getAssignments(size_t partitionNum, std::vector<size_t>& result) const;
+	//the partitions of the current column. every node not reachable from them is released
+	void setCurrentPartitions(const std::vector<size_t>& partitions);
+	size_t bytesUsed() const;
+	size_t peakBytesUsed() const;
+	size_t assignmentsStored() const;
+	//assignments stored when the most bytes were used
+	size_t peakAssignmentsStored() const;
+	void write(BinaryWriter& out) const;
+	//replaces the contents with what write wrote, returns false if in ended early
+	bool read(BinaryReader& in);
+	//removes everything but keeps the allocated space
+	void clear();
+	//removes the columns so far, the next SNP added is the first of a new traceback. the peaks are kept
+	void restart();
 private:
-	std::vector<size_t> getPartitionAssignments(size_t partitionNum, const std::set<size_t>& indexes) const;
-	size_t extend(size_t index, const std::vector<size_t>& extension);
-	std::vector<size_t> unusedIndices;
-	//assignment, position, previous index
-	std::vector<std::tuple<unsigned char, size_t, size_t>> partitionsLinkedList;
+	class Block
+	{
+	public:
+		size_t firstPosition;
+		size_t numAssignments;
+		size_t bytesPerNode;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> refCounts;
+		std::vector<unsigned char> assignments;
+		size_t liveNodes;
+	};
+	size_t getAssignment(const Block& block, size_t node, size_t index) const;
+	void setAssignment(Block& block, size_t node, size_t index, size_t value);
+	void release(size_t block, size_t node);
+	void compact(size_t block);
+	size_t blockBytes(const Block& block) const;
+	std::vector<size_t> getPartitionAssignments(size_t partitionNum, const ActiveRowSet& indexes) const;
+	std::vector<Block> blocks;
+	//block of the current partitions
+	size_t currentBlock;
+	std::vector<size_t> currentPartitions;
+	std::vector<size_t> dirtyBlocks;
 	std::vector<size_t> readOrdering;
+	//indexed by row-firstRow
 	std::vector<size_t> inverseReadOrdering;
+	//indexed by SNP-firstSNP
 	std::vector<size_t> SNPstarts;
+	size_t firstSNP;
+	size_t firstRow;
 	size_t k;
+	size_t bitsPerAssignment;
+	size_t usedBytes;
+	size_t peakBytes;
+	size_t storedAssignments;
+	size_t peakAssignments;
 };
 
-void SparsePartitionContainer::reserveMore(size_t moreIndices)
+SparsePartitionContainer::SparsePartitionContainer(size_t k) :
+	blocks(),
+	currentBlock(-1),
+	currentPartitions(),
+	dirtyBlocks(),
+	readOrdering(),
+	inverseReadOrdering(),
+	SNPstarts(),
+	firstSNP(0),
+	firstRow(0),
+	k(k),
+	bitsPerAssignment(std::max(ceil(log2(k)), 1.0)),
+	usedBytes(0),
+	peakBytes(0),
+	storedAssignments(0),
+	peakAssignments(0)
 {
-	if (moreIndices <= unusedIndices.size())
-	{
-		return;
-	}
-	partitionsLinkedList.reserve(partitionsLinkedList.size()+moreIndices-unusedIndices.size());
+	assert(bitsPerAssignment <= 8);
 }
 
-SparsePartitionContainer::SparsePartitionContainer(const std::vector<std::set<size_t>>& readsPerSNP, size_t k) :
-	unusedIndices(),
-	partitionsLinkedList(),
-	readOrdering(),
-	inverseReadOrdering(),
-	k(k)
+void SparsePartitionContainer::addSNP(size_t SNPnum, const ActiveRowSet& reads)
 {
-	std::set<size_t> usedReads;
-	for (auto x : readsPerSNP)
+	if (SNPstarts.size() == 0)
+	{
+		firstSNP = SNPnum;
+	}
+	assert(SNPnum >= firstSNP);
+	assert(SNPstarts.size() <= SNPnum-firstSNP+1);
+	while (SNPstarts.size() <= SNPnum-firstSNP)
 	{
 		SNPstarts.push_back(readOrdering.size());
-		for (auto y : x)
+	}
+	for (auto x : reads)
+	{
+		if (readOrdering.size() == 0)
 		{
-			if (usedReads.count(y) == 0)
-			{
-				usedReads.insert(y);
-				readOrdering.push_back(y);
-			}
+			firstRow = x;
+		}
+		//rows numbered in the order they start never go below the first one
+		if (x < firstRow)
+		{
+			inverseReadOrdering.insert(inverseReadOrdering.begin(), firstRow-x, -1);
+			firstRow = x;
+		}
+		if (inverseReadOrdering.size() <= x-firstRow)
+		{
+			inverseReadOrdering.resize(x-firstRow+1, -1);
+		}
+		if (inverseReadOrdering[x-firstRow] == (size_t)-1)
+		{
+			inverseReadOrdering[x-firstRow] = readOrdering.size();
+			readOrdering.push_back(x);
 		}
 	}
-	for (size_t i = 0; i < usedReads.size(); i++)
+	SNPstarts.push_back(readOrdering.size());
+}
+
+size_t SparsePartitionContainer::blockBytes(const Block& block) const
+{
+	return block.parents.capacity()*sizeof(uint32_t) + block.refCounts.capacity()*sizeof(uint32_t) + block.assignments.capacity() + sizeof(Block);
+}
+
+void SparsePartitionContainer::startSNP(size_t SNPnum, size_t numPartitions)
+{
+	SNPnum -= firstSNP;
+	assert(SNPnum+1 < SNPstarts.size());
+	size_t numNews = SNPstarts[SNPnum+1]-SNPstarts[SNPnum];
+	if (numNews == 0)
 	{
-		assert(usedReads.count(i) > 0);
+		return;
 	}
-	assert(readOrdering.size() == (*std::max_element(readOrdering.begin(), readOrdering.end()))+1);
-	assert(usedReads.size() == (*usedReads.upper_bound(-1)));
-	SNPstarts.push_back(readOrdering.size());
-	inverseReadOrdering.resize(readOrdering.size(), -1);
-	for (size_t i = 0; i < readOrdering.size(); i++)
+	assert(numPartitions <= std::numeric_limits<uint32_t>::max());
+	assert(blocks.size() == 0 || currentBlock == blocks.size()-1);
+	blocks.emplace_back();
+	Block& block = blocks.back();
+	block.firstPosition = SNPstarts[SNPnum];
+	block.numAssignments = numNews;
+	block.bytesPerNode = (numNews*bitsPerAssignment+7)/8;
+	block.parents.resize(numPartitions, -1);
+	block.refCounts.resize(numPartitions, 0);
+	block.assignments.resize(numPartitions*block.bytesPerNode, 0);
+	block.liveNodes = numPartitions;
+	usedBytes += blockBytes(block);
+	storedAssignments += numPartitions*numNews;
+	if (usedBytes > peakBytes)
+	{
+		peakBytes = usedBytes;
+		peakAssignments = storedAssignments;
+	}
+}
+
+size_t SparsePartitionContainer::getAssignment(const Block& block, size_t node, size_t index) const
+{
+	size_t bit = index*bitsPerAssignment;
+	size_t byte = node*block.bytesPerNode+bit/8;
+	size_t value = block.assignments[byte];
+	if (bit%8+bitsPerAssignment > 8)
 	{
-		assert(readOrdering[i] < inverseReadOrdering.size());
-		inverseReadOrdering[readOrdering[i]] = i;
+		value |= (size_t)block.assignments[byte+1] << 8;
 	}
+	return (value >> (bit%8)) & ((1 << bitsPerAssignment)-1);
 }
 
-size_t SparsePartitionContainer::insertPartition(const SparsePartition& partition, size_t SNPnum, size_t size)
+void SparsePartitionContainer::setAssignment(Block& block, size_t node, size_t index, size_t value)
 {
-	assert(SNPstarts[SNPnum] == 0);
+	assert(value < k);
+	size_t bit = index*bitsPerAssignment;
+	size_t byte = node*block.bytesPerNode+bit/8;
+	value <<= bit%8;
+	block.assignments[byte] |= value & 0xFF;
+	if (bit%8+bitsPerAssignment > 8)
+	{
+		block.assignments[byte+1] |= value >> 8;
+	}
+}
+
+size_t SparsePartitionContainer::insertPartition(const SparsePartition& partition, size_t SNPnum, size_t size, size_t node)
+{
+	assert(SNPstarts[SNPnum-firstSNP] == 0);
+	assert(blocks.size() == 1);
+	assert(currentBlock == -1);
 #ifndef NDEBUG
 	assert(size == partition.inner.assignments.size());
 #endif
-	std::vector<size_t> extension;
+	Block& block = blocks.back();
+	assert(size == block.numAssignments);
+	assert(node < block.parents.size());
 	for (size_t i = 0; i < size; i++)
 	{
-		extension.push_back(partition.inner.assignments[i]);
+		setAssignment(block, node, i, partition.inner.assignments[i]);
 	}
-	return extend(-1, extension);
+	return node;
 }
 
-size_t SparsePartitionContainer::extendPartition(size_t partitionNum, const SparsePartition& partition, size_t SNPnum, size_t maxSNP, const std::set<size_t>& oldActives, const std::set<size_t>& partitionActives, const std::set<size_t>& intersection)
+size_t SparsePartitionContainer::extendPartition(size_t partitionNum, const SparsePartition& partition, size_t SNPnum, size_t maxSNP, size_t numOldActives, const ActiveRowSet& partitionActives, const ActiveRowSet& intersection, size_t node)
 {
+	SNPnum -= firstSNP;
 	size_t numNews = SNPstarts[SNPnum+1]-SNPstarts[SNPnum];
 	assert(numNews == partitionActives.size()-intersection.size());
 	if (numNews == 0)
 	{
 		return partitionNum;
 	}
-	assert(partitionNum < partitionsLinkedList.size());
+	assert(currentBlock+1 == blocks.size()-1);
+	assert(partitionNum < blocks[currentBlock].parents.size());
 	std::vector<size_t> rightNumbering;
 	rightNumbering.reserve(intersection.size());
 	for (auto x : intersection)
@@ -654,270 +1368,475 @@ size_t SparsePartitionContainer::extendPartition(size_t partitionNum, const Spar
 	}
 	std::vector<size_t> leftNumbering = getPartitionAssignments(partitionNum, intersection);
 	std::vector<size_t> numbering = getNumbering(leftNumbering, rightNumbering, k);
-	std::vector<size_t> extension;
-	extension.reserve(SNPstarts[SNPnum+1]-SNPstarts[SNPnum]);
-	for (size_t i = SNPstarts[SNPnum]; i < SNPstarts[SNPnum+1]; i++)
-	{
-		extension.push_back(numbering[partition.getAssignment(readOrdering[i], partitionActives)]);
-	}
-	assert(SNPstarts[SNPnum] == oldActives.size());
-	assert(oldActives.size() + extension.size() == setUnion(oldActives, partitionActives).size());
-	size_t result = extend(partitionNum, extension);
-	return result;
-}
-
-size_t SparsePartitionContainer::extend(size_t index, const std::vector<size_t>& extension)
-{
-	size_t position = 0;
-	if (index != -1)
-	{
-		position = std::get<1>(partitionsLinkedList[index])+1;
-	}
-	for (size_t i = 0; i < extension.size(); i++)
+	assert(SNPstarts[SNPnum] == numOldActives);
+	Block& block = blocks.back();
+	assert(block.firstPosition == SNPstarts[SNPnum]);
+	assert(node < block.parents.size());
+	block.parents[node] = partitionNum;
+	for (size_t i = 0; i < numNews; i++)
 	{
-		size_t putHere;
-		if (unusedIndices.size() > 0)
-		{
-			putHere = unusedIndices.back();
-			unusedIndices.pop_back();
-		}
-		else
-		{
-			putHere = partitionsLinkedList.size();
-			partitionsLinkedList.emplace_back(-1, -1, -1);
-		}
-		assert(putHere < partitionsLinkedList.size());
-		std::get<0>(partitionsLinkedList[putHere]) = extension[i];
-		std::get<1>(partitionsLinkedList[putHere]) = position;
-		std::get<2>(partitionsLinkedList[putHere]) = index;
-		position++;
-		index = putHere;
+		setAssignment(block, node, i, numbering[partition.getAssignment(readOrdering[SNPstarts[SNPnum]+i], partitionActives)]);
 	}
-	return index;
+	return node;
 }
 
-std::vector<size_t> SparsePartitionContainer::getPartitionAssignments(size_t partitionNum, const std::set<size_t>& indexes) const
+std::vector<size_t> SparsePartitionContainer::getPartitionAssignments(size_t partitionNum, const ActiveRowSet& indexes) const
 {
 	std::vector<size_t> ret;
 	ret.resize(indexes.size(), -1);
-	std::set<size_t> remaining = indexes;
-	size_t index = partitionNum;
-	size_t position;
-	while (index != -1 && remaining.size() > 0)
+	size_t remaining = indexes.size();
+	size_t node = partitionNum;
+	for (size_t block = currentBlock; block != -1 && remaining > 0; block--)
 	{
-		position = std::get<1>(partitionsLinkedList[index]);
-		if (remaining.count(readOrdering[position]) > 0)
+		assert(node < blocks[block].parents.size());
+		for (size_t i = 0; i < blocks[block].numAssignments; i++)
 		{
-			remaining.erase(readOrdering[position]);
-			size_t pos = 0;
-			for (auto iter = indexes.begin(); iter != indexes.end(); iter++)
+			size_t read = readOrdering[blocks[block].firstPosition+i];
+			if (indexes.contains(read))
 			{
-				if (*iter == readOrdering[position])
-				{
-					ret[pos] = std::get<0>(partitionsLinkedList[index]);
-					break;
-				}
-				pos++;
+				size_t pos = indexes.rank(read);
+				assert(ret[pos] == -1);
+				ret[pos] = getAssignment(blocks[block], node, i);
+				remaining--;
 			}
 		}
-		index = std::get<2>(partitionsLinkedList[index]);
+		node = blocks[block].parents[node];
 	}
-	assert(remaining.size() == 0);
+	assert(remaining == 0);
 	assert(std::none_of(ret.begin(), ret.end(), [](size_t x) { return x == -1;}));
 
 	return ret;
 }
 
-SparsePartition SparsePartitionContainer::getPartition(size_t partitionNum, size_t maxSNP, TinyVectorMemoryAllocator& allocator) const
+void SparsePartitionContainer::getAssignments(size_t partitionNum, std::vector<size_t>& result) const
 {
+	assert(currentBlock != (size_t)-1);
 	std::vector<size_t> assignments;
-	assert(partitionNum < partitionsLinkedList.size());
-	size_t index = partitionNum;
-	size_t position = std::get<1>(partitionsLinkedList[index]);
-	assignments.resize(position+1, -1);
-	while (index != -1)
-	{
-		assert(index == partitionNum ^ std::get<1>(partitionsLinkedList[index])+1 == position);
-		position = std::get<1>(partitionsLinkedList[index]);
-		assignments[position] = std::get<0>(partitionsLinkedList[index]);
-		index = std::get<2>(partitionsLinkedList[index]);
-	}
-	assert(position == 0);
-
-	SparsePartition ret;
-	ret.inner.assignments.reserve(assignments.size(), allocator);
-#ifndef NDEBUG
-	ret.inner.assignments.actualSize = assignments.size();
-#endif
-	size_t num = 0;
-	for (size_t i = 0; i < inverseReadOrdering.size(); i++)
+	assignments.resize(blocks[currentBlock].firstPosition+blocks[currentBlock].numAssignments, -1);
+	size_t node = partitionNum;
+	for (size_t block = currentBlock; block != -1; block--)
 	{
-		if (inverseReadOrdering[i] < assignments.size())
+		assert(node < blocks[block].parents.size());
+		assert(block == 0 || blocks[block-1].firstPosition+blocks[block-1].numAssignments == blocks[block].firstPosition);
+		for (size_t i = 0; i < blocks[block].numAssignments; i++)
 		{
-			assert(assignments[inverseReadOrdering[i]] != -1);
-			assert(num < assignments.size());
-			assert(num < ret.inner.assignments.size());
-			ret.inner.assignments[num] = assignments[inverseReadOrdering[i]];
-			num++;
+			assignments[blocks[block].firstPosition+i] = getAssignment(blocks[block], node, i);
 		}
+		node = blocks[block].parents[node];
+	}
+	assert(blocks[0].firstPosition == 0);
+	assert(assignments.size() == readOrdering.size());
+	if (result.size() < firstRow+inverseReadOrdering.size())
+	{
+		result.resize(firstRow+inverseReadOrdering.size(), 0);
+	}
+	for (size_t i = 0; i < assignments.size(); i++)
+	{
+		assert(assignments[i] != (size_t)-1);
+		result[readOrdering[i]] = assignments[i];
 	}
-	assert(num == assignments.size());
-	return ret;
 }
 
-void SparsePartitionContainer::clearUnused(std::vector<size_t> used)
+void SparsePartitionContainer::release(size_t block, size_t node)
 {
-	std::vector<bool> isUsed;
-	isUsed.resize(partitionsLinkedList.size(), false);
-	for (auto x : used)
+	while (block != -1)
 	{
-		assert(x < partitionsLinkedList.size());
-		isUsed[x] = true;
-		while (std::get<2>(partitionsLinkedList[x]) != -1 && !isUsed[std::get<2>(partitionsLinkedList[x])])
+		assert(blocks[block].refCounts[node] > 0);
+		blocks[block].refCounts[node]--;
+		if (blocks[block].refCounts[node] > 0)
 		{
-			x = std::get<2>(partitionsLinkedList[x]);
-			assert(x < partitionsLinkedList.size());
-			isUsed[x] = true;
+			return;
 		}
-	}
-	for (auto x : unusedIndices)
-	{
-		assert(x < partitionsLinkedList.size());
-		isUsed[x] = true;
-/*		while (std::get<2>(partitionsLinkedList[x]) != -1 && !isUsed[std::get<2>(partitionsLinkedList[x])])
+		blocks[block].liveNodes--;
+		storedAssignments -= blocks[block].numAssignments;
+		if (dirtyBlocks.size() == 0 || dirtyBlocks.back() != block)
 		{
-			x = std::get<2>(partitionsLinkedList[x]);
-			assert(x < partitionsLinkedList.size());
-			isUsed[x] = true;
-		}*/
+			dirtyBlocks.push_back(block);
+		}
+		size_t parent = blocks[block].parents[node];
+		blocks[block].parents[node] = -1;
+		block--;
+		node = parent;
 	}
-	while (partitionsLinkedList.size() > 0 && !isUsed[partitionsLinkedList.size()-1])
+}
+
+//moves the live nodes of block to the front and renumbers the parents in the next block
+void SparsePartitionContainer::compact(size_t block)
+{
+	assert(block+1 < blocks.size());
+	Block& old = blocks[block];
+	std::vector<uint32_t> newIndex;
+	newIndex.resize(old.parents.size(), -1);
+	size_t live = 0;
+	for (size_t i = 0; i < old.parents.size(); i++)
 	{
-		partitionsLinkedList.pop_back();
+		if (old.refCounts[i] == 0)
+		{
+			continue;
+		}
+		newIndex[i] = live;
+		old.parents[live] = old.parents[i];
+		old.refCounts[live] = old.refCounts[i];
+		std::copy(old.assignments.begin()+i*old.bytesPerNode, old.assignments.begin()+(i+1)*old.bytesPerNode, old.assignments.begin()+live*old.bytesPerNode);
+		live++;
 	}
-	for (size_t i = 0; i < partitionsLinkedList.size(); i++)
+	assert(live == old.liveNodes);
+	usedBytes -= blockBytes(old);
+	old.parents.resize(live);
+	old.parents.shrink_to_fit();
+	old.refCounts.resize(live);
+	old.refCounts.shrink_to_fit();
+	old.assignments.resize(live*old.bytesPerNode);
+	old.assignments.shrink_to_fit();
+	usedBytes += blockBytes(old);
+	for (auto& parent : blocks[block+1].parents)
 	{
-		if (!isUsed[i])
+		if (parent != (uint32_t)-1)
 		{
-			unusedIndices.push_back(i);
+			assert(newIndex[parent] != (uint32_t)-1);
+			parent = newIndex[parent];
 		}
 	}
-	unusedIndices.shrink_to_fit();
-	partitionsLinkedList.shrink_to_fit();
 }
 
-//must not return permutations, otherwise will produce about k! times more partitions than necessary
-//[start, end)
-std::vector<SolidPartition> SolidPartition::getAllPartitions(size_t start, size_t end, TinyVectorMemoryAllocator& allocator)
+void SparsePartitionContainer::setCurrentPartitions(const std::vector<size_t>& partitions)
 {
-	assert(end > start);
-	std::vector<SolidPartition> ret;
-	ret.reserve(getApproxNumberOfPartitions(end-start, k));
-	std::vector<size_t> newPartition;
-	newPartition.resize(end-start+5, 0);
-	std::vector<size_t> rowsOccupied;
-	rowsOccupied.resize(k+5, 0);
-	rowsOccupied[0] = end-start;
-	if (end == start+1)
-	{
-		ret.emplace_back(newPartition.begin(), newPartition.begin()+(end-start), end-start, allocator);
-		return ret;
-	}
-	size_t loc = end-start-1;
-	bool repeat = true;
-	while (repeat)
-	{
-		ret.emplace_back(newPartition.begin(), newPartition.begin()+(end-start), end-start, allocator);
-		assert(loc < end-start);
-		assert(newPartition[loc] < k);
-		assert(rowsOccupied[newPartition[loc]] > 0);
-		assert(rowsOccupied[newPartition[loc]] <= end-start);
-		rowsOccupied[newPartition[loc]]--;
-		newPartition[loc]++;
-		rowsOccupied[newPartition[loc]]++;
-		assert(loc < end-start);
-		assert(newPartition[loc] <= k);
-		assert(rowsOccupied[newPartition[loc]] > 0);
-		assert(rowsOccupied[newPartition[loc]] <= end-start);
-		if (rowsOccupied[newPartition[loc]-1] == 0 || newPartition[loc] == k)
-		{
-			while (rowsOccupied[newPartition[loc]-1] == 0 || newPartition[loc] == k)
-			{
-				assert(loc < end-start);
-				assert(newPartition[loc] <= k);
-				assert(rowsOccupied[newPartition[loc]] > 0);
-				assert(rowsOccupied[newPartition[loc]] <= end-start);
-				rowsOccupied[newPartition[loc]]--;
-				newPartition[loc] = 0;
-				rowsOccupied[newPartition[loc]]++;
-				assert(loc < end-start);
-				assert(newPartition[loc] <= k);
-				assert(rowsOccupied[newPartition[loc]] > 0);
-				assert(rowsOccupied[newPartition[loc]] <= end-start);
-				assert(loc < end-start);
-				loc--;
-				if (loc == 0)
-				{
-					repeat = false;
-					break;
-				}
-				assert(loc < end-start);
-				assert(newPartition[loc] <= k);
-				assert(rowsOccupied[newPartition[loc]] > 0);
-				assert(rowsOccupied[newPartition[loc]] <= end-start);
-				rowsOccupied[newPartition[loc]]--;
-				newPartition[loc]++;
-				rowsOccupied[newPartition[loc]]++;
-				assert(loc < end-start);
-				assert(newPartition[loc] <= k);
-				assert(rowsOccupied[newPartition[loc]] > 0);
-				assert(rowsOccupied[newPartition[loc]] <= end-start);
+	size_t newBlock = blocks.size()-1;
+	assert(newBlock == currentBlock || newBlock == currentBlock+1);
+	if (newBlock != currentBlock)
+	{
+		//children reference their parents, nodes of the new block which are not used are released below
+		for (auto parent : blocks[newBlock].parents)
+		{
+			if (parent != (uint32_t)-1)
+			{
+				blocks[currentBlock].refCounts[parent]++;
 			}
-			loc = end-start-1;
+		}
+		for (auto& count : blocks[newBlock].refCounts)
+		{
+			count++;
 		}
 	}
-	return ret;
-}
-
-//basically <
-bool partitionCompare(const SolidPartition& left, const SolidPartition& right, size_t size)
-{
-#ifndef NDEBUG
-	assert(size == left.assignments.actualSize);
-	assert(size == right.assignments.actualSize);
-#endif
-	int compare = memcmp((const char*)left.assignments.data.data(), (const char*)right.assignments.data.data(), size*log2k/8);
-	if (compare < 0)
+	for (auto x : partitions)
 	{
-		return true;
+		assert(x < blocks[newBlock].parents.size());
+		blocks[newBlock].refCounts[x]++;
 	}
-	if (compare > 0)
+	for (auto x : currentPartitions)
 	{
-		return false;
+		release(currentBlock, x);
 	}
-	for (size_t i = (size*log2k/8)*8/log2k; i < size; i++)
+	if (newBlock != currentBlock)
 	{
-		if (left.assignments[i] < right.assignments[i])
+		for (size_t i = 0; i < blocks[newBlock].parents.size(); i++)
 		{
-			return true;
+			release(newBlock, i);
 		}
-		if (left.assignments[i] > right.assignments[i])
+	}
+	currentBlock = newBlock;
+	currentPartitions = partitions;
+	std::sort(dirtyBlocks.begin(), dirtyBlocks.end());
+	dirtyBlocks.erase(std::unique(dirtyBlocks.begin(), dirtyBlocks.end()), dirtyBlocks.end());
+	for (auto block : dirtyBlocks)
+	{
+		if (block != currentBlock && blocks[block].liveNodes*2 <= blocks[block].parents.size())
 		{
-			return false;
+			compact(block);
 		}
 	}
-	return false;
+	dirtyBlocks.clear();
 }
 
-//first index is new partition index, second index (inner vector) is old partition indices
-std::vector<std::vector<size_t>> findExtensions(const std::vector<std::pair<size_t, SolidPartition>>& newLastRow, const std::vector<std::pair<size_t, SolidPartition>>& newNewRow, size_t size)
+size_t SparsePartitionContainer::bytesUsed() const
 {
-	std::vector<std::vector<size_t>> ret;
-	ret.resize(newNewRow.size());
-	size_t lastIndex = 0;
-	size_t newIndex = 0;
-	while (lastIndex < newLastRow.size() && newIndex < newNewRow.size())
-	{
+	return usedBytes;
+}
+
+size_t SparsePartitionContainer::peakBytesUsed() const
+{
+	return peakBytes;
+}
+
+size_t SparsePartitionContainer::assignmentsStored() const
+{
+	return storedAssignments;
+}
+
+size_t SparsePartitionContainer::peakAssignmentsStored() const
+{
+	return peakAssignments;
+}
+
+void SparsePartitionContainer::write(BinaryWriter& out) const
+{
+	out.write((uint64_t)blocks.size());
+	for (const Block& block : blocks)
+	{
+		out.write((uint64_t)block.firstPosition);
+		out.write((uint64_t)block.numAssignments);
+		out.write((uint64_t)block.bytesPerNode);
+		out.write(block.parents);
+		out.write(block.refCounts);
+		out.write(block.assignments);
+		out.write((uint64_t)block.liveNodes);
+	}
+	out.write((uint64_t)currentBlock);
+	out.write(currentPartitions);
+	out.write(dirtyBlocks);
+	out.write(readOrdering);
+	out.write(inverseReadOrdering);
+	out.write(SNPstarts);
+	out.write((uint64_t)firstSNP);
+	out.write((uint64_t)firstRow);
+	out.write((uint64_t)peakBytes);
+	out.write((uint64_t)storedAssignments);
+	out.write((uint64_t)peakAssignments);
+}
+
+bool SparsePartitionContainer::read(BinaryReader& in)
+{
+	blocks.resize(in.read<uint64_t>());
+	usedBytes = 0;
+	for (Block& block : blocks)
+	{
+		block.firstPosition = in.read<uint64_t>();
+		block.numAssignments = in.read<uint64_t>();
+		block.bytesPerNode = in.read<uint64_t>();
+		block.parents = in.readVector<uint32_t>();
+		block.refCounts = in.readVector<uint32_t>();
+		block.assignments = in.readVector<unsigned char>();
+		block.liveNodes = in.read<uint64_t>();
+		usedBytes += blockBytes(block);
+		if (!in.good())
+		{
+			return false;
+		}
+	}
+	currentBlock = in.read<uint64_t>();
+	currentPartitions = in.readVector<size_t>();
+	dirtyBlocks = in.readVector<size_t>();
+	readOrdering = in.readVector<size_t>();
+	inverseReadOrdering = in.readVector<size_t>();
+	SNPstarts = in.readVector<size_t>();
+	firstSNP = in.read<uint64_t>();
+	firstRow = in.read<uint64_t>();
+	peakBytes = std::max((size_t)in.read<uint64_t>(), usedBytes);
+	storedAssignments = in.read<uint64_t>();
+	peakAssignments = in.read<uint64_t>();
+	return in.good();
+}
+
+void SparsePartitionContainer::clear()
+{
+	restart();
+	peakBytes = 0;
+	peakAssignments = 0;
+}
+
+void SparsePartitionContainer::restart()
+{
+	blocks.clear();
+	currentBlock = -1;
+	currentPartitions.clear();
+	dirtyBlocks.clear();
+	readOrdering.clear();
+	inverseReadOrdering.clear();
+	SNPstarts.clear();
+	firstSNP = 0;
+	firstRow = 0;
+	usedBytes = 0;
+	storedAssignments = 0;
+}
+
+//what a DP run allocates, kept between the runs of a Haplotyper so they start with warm buffers
+class DPWorkspace;
+
+//the workspaces of the blocks or windows running as jobs on a pool's threads, kept between the jobs and the runs
+//at most one per pool thread is kept, so a later job takes a warm workspace instead of allocating its own
+class JobWorkspaces
+{
+public:
+	JobWorkspaces(size_t k, size_t maxKept);
+	//a workspace which no other job is using, with numThreads threads of its own
+	std::unique_ptr<DPWorkspace> take(size_t numThreads);
+	void give(std::unique_ptr<DPWorkspace> workspace);
+private:
+	size_t k;
+	size_t maxKept;
+	std::mutex mutex;
+	std::vector<std::unique_ptr<DPWorkspace>> idle;
+};
+
+class DPWorkspace
+{
+public:
+	DPWorkspace(size_t k, size_t numThreads);
+	ThreadPool pool;
+	TinyVectorMemoryAllocator oldRowMemoryAllocator;
+	TinyVectorMemoryAllocator newRowMemoryAllocator;
+	SparsePartitionContainer traceback;
+	//for the jobs run on pool
+	JobWorkspaces jobs;
+};
+
+DPWorkspace::DPWorkspace(size_t k, size_t numThreads) :
+	pool(std::max(numThreads, (size_t)1), [k]() { RunParameters::set(k); }),
+	oldRowMemoryAllocator(),
+	newRowMemoryAllocator(),
+	traceback(k),
+	jobs(k, std::max(numThreads, (size_t)1))
+{
+}
+
+JobWorkspaces::JobWorkspaces(size_t k, size_t maxKept) :
+	k(k),
+	maxKept(maxKept),
+	mutex(),
+	idle()
+{
+}
+
+std::unique_ptr<DPWorkspace> JobWorkspaces::take(size_t numThreads)
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		for (size_t i = 0; i < idle.size(); i++)
+		{
+			if (idle[i]->pool.size() == numThreads)
+			{
+				std::unique_ptr<DPWorkspace> result = std::move(idle[i]);
+				idle.erase(idle.begin()+i);
+				return result;
+			}
+		}
+	}
+	return std::unique_ptr<DPWorkspace> { new DPWorkspace { k, numThreads } };
+}
+
+void JobWorkspaces::give(std::unique_ptr<DPWorkspace> workspace)
+{
+	std::unique_ptr<DPWorkspace> dropped;
+	std::lock_guard<std::mutex> lock { mutex };
+	idle.push_back(std::move(workspace));
+	//a workspace with another number of threads than the later jobs want is dropped first
+	if (idle.size() > maxKept)
+	{
+		dropped = std::move(idle.front());
+		idle.erase(idle.begin());
+	}
+}
+
+//calls f for every partition of [0, length) into at most k sets whose first prefixLength assignments are the ones in partition
+//in lexicographic order. a set number is at most one bigger than the biggest set number before it, so no permutations are returned
+template <typename F>
+void forEachPartitionWithPrefix(std::vector<size_t> partition, size_t prefixLength, size_t length, size_t k, F f)
+{
+	assert(prefixLength > 0);
+	assert(prefixLength <= length);
+	assert(partition.size() >= prefixLength);
+	assert(partition[0] == 0);
+	partition.resize(length, 0);
+	//maxBefore[i] is the biggest set number in [0, i)
+	std::vector<size_t> maxBefore;
+	maxBefore.resize(length+1, 0);
+	for (size_t i = 1; i <= length; i++)
+	{
+		maxBefore[i] = std::max(maxBefore[i-1], partition[i-1]);
+	}
+	while (true)
+	{
+		f(partition);
+		size_t loc = length;
+		while (loc > prefixLength && (partition[loc-1] == k-1 || partition[loc-1] > maxBefore[loc-1]))
+		{
+			loc--;
+		}
+		if (loc == prefixLength)
+		{
+			return;
+		}
+		loc--;
+		partition[loc]++;
+		for (size_t i = loc+1; i < length; i++)
+		{
+			partition[i] = 0;
+		}
+		for (size_t i = loc+1; i <= length; i++)
+		{
+			maxBefore[i] = std::max(maxBefore[i-1], partition[i-1]);
+		}
+	}
+}
+
+//must not return permutations, otherwise will produce about k! times more partitions than necessary
+//[start, end)
+std::vector<SolidPartition> SolidPartition::getAllPartitions(size_t start, size_t end, TinyVectorMemoryAllocator& allocator, ThreadPool& pool)
+{
+	assert(end > start);
+	size_t length = end-start;
+	size_t maxSets = k;
+	std::vector<SolidPartition> ret;
+	ret.reserve(getNumberOfPartitions(length, maxSets));
+	//split into lexicographically consecutive ranges by prefix, so the concatenation is in the same order as the serial enumeration
+	size_t prefixLength = 1;
+	std::vector<std::vector<size_t>> prefixes;
+	prefixes.emplace_back(1, 0);
+	if (pool.size() > 1 && getNumberOfPartitions(length, maxSets) > 16384)
+	{
+		while (prefixLength < length && prefixes.size() < pool.size()*8)
+		{
+			std::vector<std::vector<size_t>> longerPrefixes;
+			for (const auto& prefix : prefixes)
+			{
+				forEachPartitionWithPrefix(prefix, prefixLength, prefixLength+1, maxSets, [&longerPrefixes](const std::vector<size_t>& partition) { longerPrefixes.push_back(partition); });
+			}
+			prefixes = std::move(longerPrefixes);
+			prefixLength++;
+		}
+	}
+	std::vector<std::vector<SolidPartition>> parts;
+	parts.resize(prefixes.size());
+	pool.run(prefixes.size(), [&parts, &prefixes, &allocator, prefixLength, length, maxSets](size_t i)
+	{
+		forEachPartitionWithPrefix(prefixes[i], prefixLength, length, maxSets, [&parts, &allocator, i, length](const std::vector<size_t>& partition)
+		{
+			parts[i].emplace_back(partition.begin(), partition.end(), length, allocator);
+		});
+	});
+	for (auto& part : parts)
+	{
+		ret.insert(ret.end(), part.begin(), part.end());
+		clearVector(part);
+	}
+	return ret;
+}
+
+//basically <
+template <typename Layout>
+bool partitionCompare(const SolidPartition& left, const SolidPartition& right, size_t size)
+{
+#ifndef NDEBUG
+	assert(size == left.assignments.actualSize);
+	assert(size == right.assignments.actualSize);
+#endif
+	return Layout::less(left.assignments.rawData(), right.assignments.rawData(), size);
+}
+
+bool partitionCompare(const SolidPartition& left, const SolidPartition& right, size_t size)
+{
+	return partitionCompare<RuntimeLayout>(left, right, size);
+}
+
+//first index is new partition index, second index (inner vector) is old partition indices
+std::vector<std::vector<size_t>> findExtensions(const std::vector<std::pair<size_t, SolidPartition>>& newLastRow, const std::vector<std::pair<size_t, SolidPartition>>& newNewRow, size_t size)
+{
+	std::vector<std::vector<size_t>> ret;
+	ret.resize(newNewRow.size());
+	size_t lastIndex = 0;
+	size_t newIndex = 0;
+	while (lastIndex < newLastRow.size() && newIndex < newNewRow.size())
+	{
 		if (partitionCompare(newLastRow[lastIndex].second, newNewRow[newIndex].second, size))
 		{
 			lastIndex++;
@@ -954,29 +1873,29 @@ std::vector<std::vector<size_t>> findExtensions(const std::vector<std::pair<size
 	return ret;
 }
 
-std::vector<size_t> findExtensions(const std::vector<std::pair<size_t, SolidPartition>>& newLastRow, const std::vector<std::pair<size_t, SolidPartition>>& newNewRow, size_t size, const std::vector<double>& oldCosts)
+//merge-joins newNewRow[newIndex, newIndexEnd) with newLastRow, newIndex and newIndexEnd must not split a group of equal partitions
+template <typename Layout>
+void findExtensionsInRange(const std::vector<std::pair<size_t, SolidPartition>>& newLastRow, const std::vector<std::pair<size_t, SolidPartition>>& newNewRow, size_t size, const std::vector<double>& oldCosts, size_t newIndex, size_t newIndexEnd, std::vector<size_t>& ret)
 {
-	std::vector<size_t> ret;
-	ret.resize(newNewRow.size(), -1);
-	size_t lastIndex = 0;
-	size_t newIndex = 0;
-	while (lastIndex < newLastRow.size() && newIndex < newNewRow.size())
+	size_t lastIndex = std::lower_bound(newLastRow.begin(), newLastRow.end(), newNewRow[newIndex], [size](const std::pair<size_t, SolidPartition>& left, const std::pair<size_t, SolidPartition>& right) { return partitionCompare<Layout>(left.second, right.second, size); }) - newLastRow.begin();
+	size_t rangeEnd = newIndexEnd;
+	while (lastIndex < newLastRow.size() && newIndex < rangeEnd)
 	{
-		if (partitionCompare(newLastRow[lastIndex].second, newNewRow[newIndex].second, size))
+		if (partitionCompare<Layout>(newLastRow[lastIndex].second, newNewRow[newIndex].second, size))
 		{
 			lastIndex++;
 		}
-		else if (partitionCompare(newNewRow[newIndex].second, newLastRow[lastIndex].second, size))
+		else if (partitionCompare<Layout>(newNewRow[newIndex].second, newLastRow[lastIndex].second, size))
 		{
 			newIndex++;
 		}
 		else
 		{
-			size_t newIndexEnd = newIndex+1;
+			newIndexEnd = newIndex+1;
 			size_t lastIndexEnd = lastIndex+1;
 			double minCost = oldCosts[newLastRow[lastIndex].first];
 			size_t minCostIndex = newLastRow[lastIndex].first;
-			while (lastIndexEnd < newLastRow.size() && !partitionCompare(newLastRow[lastIndexEnd-1].second, newLastRow[lastIndexEnd].second, size))
+			while (lastIndexEnd < newLastRow.size() && !partitionCompare<Layout>(newLastRow[lastIndexEnd-1].second, newLastRow[lastIndexEnd].second, size))
 			{
 				if (oldCosts[newLastRow[lastIndexEnd].first] < minCost)
 				{
@@ -988,7 +1907,7 @@ std::vector<size_t> findExtensions(const std::vector<std::pair<size_t, SolidPart
 			assert(newNewRow[newIndex].first < newNewRow.size());
 			assert(ret[newNewRow[newIndex].first] == -1);
 			ret[newNewRow[newIndex].first] = minCostIndex;
-			while (newIndexEnd < newNewRow.size() && !partitionCompare(newNewRow[newIndexEnd-1].second, newNewRow[newIndexEnd].second, size))
+			while (newIndexEnd < rangeEnd && !partitionCompare<Layout>(newNewRow[newIndexEnd-1].second, newNewRow[newIndexEnd].second, size))
 			{
 				assert(newNewRow[newIndexEnd].first < newNewRow.size());
 				assert(ret[newNewRow[newIndexEnd].first] == -1);
@@ -999,6 +1918,37 @@ std::vector<size_t> findExtensions(const std::vector<std::pair<size_t, SolidPart
 			lastIndex = lastIndexEnd;
 		}
 	}
+}
+
+template <typename Layout>
+std::vector<size_t> findExtensions(const std::vector<std::pair<size_t, SolidPartition>>& newLastRow, const std::vector<std::pair<size_t, SolidPartition>>& newNewRow, size_t size, const std::vector<double>& oldCosts, ThreadPool& pool)
+{
+	std::vector<size_t> ret;
+	ret.resize(newNewRow.size(), -1);
+	if (newNewRow.size() == 0)
+	{
+		return ret;
+	}
+	size_t numChunks = std::max((size_t)1, std::min(pool.size(), newNewRow.size()/4096));
+	std::vector<size_t> bounds;
+	bounds.push_back(0);
+	for (size_t i = 1; i < numChunks; i++)
+	{
+		size_t bound = std::max(bounds.back(), newNewRow.size()*i/numChunks);
+		while (bound > 0 && bound < newNewRow.size() && !partitionCompare<Layout>(newNewRow[bound-1].second, newNewRow[bound].second, size))
+		{
+			bound++;
+		}
+		bounds.push_back(bound);
+	}
+	bounds.push_back(newNewRow.size());
+	pool.run(numChunks, [&newLastRow, &newNewRow, size, &oldCosts, &bounds, &ret](size_t chunk)
+	{
+		if (bounds[chunk] < bounds[chunk+1])
+		{
+			findExtensionsInRange<Layout>(newLastRow, newNewRow, size, oldCosts, bounds[chunk], bounds[chunk+1], ret);
+		}
+	});
 	assert(std::none_of(ret.begin(), ret.end(), [](size_t x) { return x == -1; }));
 	return ret;
 }
@@ -1008,19 +1958,7 @@ void SolidPartition::unpermutate(size_t size)
 #ifndef NDEBUG
 	assert(size == assignments.size());
 #endif
-	std::vector<size_t> mapping;
-	mapping.resize(k, -1);
-	size_t nextNum = 0;
-	for (size_t i = 0; i < size; i++)
-	{
-		assert(assignments[i] < k);
-		if (mapping[assignments[i]] == -1)
-		{
-			mapping[assignments[i]] = nextNum;
-			nextNum++;
-		}
-		assignments[i] = mapping[assignments[i]];
-	}
+	RuntimeLayout::unpermutate(assignments.rawData(), size, k);
 }
 
 template <typename Iterator>
@@ -1043,41 +1981,6 @@ SolidPartition::SolidPartition(Iterator start, Iterator end, size_t numAssignmen
 	assert(pos == numAssignments);
 }
 
-std::vector<std::set<size_t>> getActiveRows(std::vector<SNPSupport> supports)
-{
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
-	}
-	maxSNP++;
-	maxRead++;
-
-	std::vector<std::pair<size_t, size_t>> rowExtent;
-	rowExtent.resize(maxRead, std::pair<size_t, size_t>{-1, 0});
-	for (auto x : supports)
-	{
-		rowExtent[x.readNum].first = std::min(x.SNPnum, rowExtent[x.readNum].first);
-		rowExtent[x.readNum].second = std::max(x.SNPnum, rowExtent[x.readNum].second);
-	}
-
-	std::vector<std::set<size_t>> ret;
-	ret.resize(maxSNP);
-	for (size_t i = 0; i < maxSNP; i++)
-	{
-		for (size_t a = 0; a < maxRead; a++)
-		{
-			if (rowExtent[a].first <= i && rowExtent[a].second >= i)
-			{
-				ret[i].insert(a);
-			}
-		}
-	}
-	return ret;
-}
-
 std::vector<size_t> findOptimalExtensions(const std::vector<std::vector<size_t>>& extensions, const std::vector<double>& oldCosts)
 {
 	std::vector<size_t> ret;
@@ -1100,178 +2003,2949 @@ std::vector<size_t> findOptimalExtensions(const std::vector<std::vector<size_t>>
 	return ret;
 }
 
-std::vector<size_t> findOptimalExtensionsWithNoOverlap(size_t num, const std::vector<double>& costs)
+template <typename Layout>
+std::vector<std::pair<size_t, SolidPartition>> splitIntersection(const std::vector<SparsePartition>& partitions, const ActiveRowSet& intersection, const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator, ThreadPool& pool)
 {
-	size_t index = 0;
-	for (size_t i = 1; i < costs.size(); i++)
+	std::vector<std::pair<size_t, SolidPartition>> result;
+	result.resize(partitions.size());
+	std::vector<size_t> pickThese = subsetIndices(intersection, actives);
+	size_t size = pickThese.size();
+	pool.forChunks(partitions.size(), 1024, [&result, &partitions, &pickThese, &allocator, size](size_t start, size_t end)
 	{
-		if (costs[i] < costs[index])
+		for (size_t i = start; i < end; i++)
 		{
-			index = i;
+			SolidPartition insertion = partitions[i].getSolidFromIndices(pickThese, allocator);
+#ifndef NDEBUG
+			assert(size == insertion.assignments.size());
+#endif
+			Layout::unpermutate(insertion.assignments.rawData(), size, k);
+			result[i] = std::make_pair(i, insertion);
 		}
-	}
-	std::vector<size_t> ret;
-	for (size_t i = 0; i < num; i++)
+	});
+	//ties broken by index so the order is the same for any number of threads
+	parallelSort(result, [size](const std::pair<size_t, SolidPartition>& left, const std::pair<size_t, SolidPartition>& right)
 	{
-		ret.push_back(index);
-	}
-	return ret;
+		if (partitionCompare<Layout>(left.second, right.second, size))
+		{
+			return true;
+		}
+		if (partitionCompare<Layout>(right.second, left.second, size))
+		{
+			return false;
+		}
+		return left.first < right.first;
+	}, pool, 4096);
+	return result;
 }
 
-std::vector<std::pair<size_t, SolidPartition>> splitIntersection(const std::vector<SparsePartition>& partitions, std::set<size_t> intersection, std::set<size_t> actives, TinyVectorMemoryAllocator& allocator)
+//hash of the first size assignments, equal for equal assignments since the bits after the last assignment are zero
+template <typename Layout>
+uint64_t partitionHash(const SolidPartition& partition, size_t size)
 {
-	std::vector<std::pair<size_t, SolidPartition>> result;
-	result.reserve(partitions.size());
-	std::set<size_t> pickThese = subsetIndices(intersection, actives);
-	size_t size = pickThese.size();
-	for (size_t i = 0; i < partitions.size(); i++)
+	const unsigned char* data = partition.assignments.rawData();
+	size_t numBytes = (size*Layout::bits()+7)/8;
+	uint64_t hash = size;
+	for (size_t byte = 0; byte < numBytes; byte += 8)
 	{
-		SolidPartition insertion = partitions[i].getSolidFromIndices(pickThese, allocator);
-		insertion.unpermutate(size);
-		result.emplace_back(i, insertion);
+		uint64_t word = 0;
+		memcpy(&word, data+byte, std::min(numBytes-byte, (size_t)8));
+		hash ^= word + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
 	}
-	std::sort(result.begin(), result.end(), [size](const std::pair<size_t, SolidPartition>& left, const std::pair<size_t, SolidPartition>& right) { return partitionCompare(left.second, right.second, size); });
-	return result;
-}
-
-template <typename T>
-void clearVector(std::vector<T>& o)
-{
-	(std::vector<T>{}).swap(o);
+	return hash;
 }
 
-//returns optimal partition and its score
-std::tuple<std::vector<size_t>, double> haplotype(std::vector<SNPSupport> supports, size_t inK)
+//the distinct unpermutated projections of a column's partitions onto the rows shared with the next column, with the cheapest partition of each
+//the first partition is kept if several are equally cheap, the same one the sort-merge join picks
+template <typename Layout>
+class ProjectionClassTable
 {
-	k = inK;
-	log2k = ceil(log2(k));
-	std::cerr << "extents\n";
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
+public:
+	ProjectionClassTable(const std::vector<SparsePartition>& partitions, const ActiveRowSet& actives, const ActiveRowSet& intersection, const std::vector<double>& costs, ThreadPool& pool) :
+		size(intersection.size()),
+		allocator(),
+		projections(),
+		hashes(),
+		table(),
+		classes()
+	{
+		std::vector<size_t> pickThese = subsetIndices(intersection, actives);
+		projections.resize(partitions.size());
+		hashes.resize(partitions.size());
+		pool.forChunks(partitions.size(), 1024, [this, &partitions, &pickThese](size_t start, size_t end)
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				projections[i] = partitions[i].getSolidFromIndices(pickThese, allocator);
+				Layout::unpermutate(projections[i].assignments.rawData(), size, k);
+				hashes[i] = partitionHash<Layout>(projections[i], size);
+			}
+		});
+		//open addressing, a slot holds the index of the cheapest partition with that projection
+		size_t tableSize = 1;
+		while (tableSize < partitions.size()*2)
+		{
+			tableSize *= 2;
+		}
+		table.resize(tableSize, -1);
+		for (size_t i = 0; i < partitions.size(); i++)
+		{
+			size_t slot = findSlot(projections[i], hashes[i]);
+			if (table[slot] == -1)
+			{
+				classes.push_back(slot);
+				table[slot] = i;
+			}
+			else if (costs[i] < costs[table[slot]])
+			{
+				table[slot] = i;
+			}
+		}
+	}
+	//cheapest partition with the same projection, which must exist
+	size_t find(const SolidPartition& projection) const
 	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
+		size_t slot = findSlot(projection, partitionHash<Layout>(projection, size));
+		assert(table[slot] != -1);
+		return table[slot];
 	}
-	maxSNP++;
-	maxRead++;
-
-	std::cerr << "split supports per SNP\n";
-	std::vector<std::vector<SNPSupport>> supportsPerSNP;
-	supportsPerSNP.resize(maxSNP);
-	for (auto x : supports)
+	size_t numClasses() const
 	{
-		supportsPerSNP[x.SNPnum].push_back(x);
+		return classes.size();
 	}
-	size_t firstSNP = 0;
-	while (supportsPerSNP[firstSNP].size() == 0)
+	//classes in order of their first partition
+	const SolidPartition& classProjection(size_t classNum) const
 	{
-		firstSNP++;
-		assert(firstSNP < supportsPerSNP.size());
+		return projections[table[classes[classNum]]];
 	}
-
-	std::cerr << "active rows\n";
-	std::vector<std::set<size_t>> activeRowsPerColumn = getActiveRows(supports);
-	SparsePartitionContainer optimalPartitions { activeRowsPerColumn, k };
-
-	std::cerr << "column " << firstSNP << " (" << activeRowsPerColumn[firstSNP].size() << ")";
-	auto lastColumnTime = std::chrono::system_clock::now();
-	Column oldColumn { supportsPerSNP[firstSNP].begin(), supportsPerSNP[firstSNP].end(), firstSNP, 0, maxRead };
-
-	TinyVectorMemoryAllocator oldRowMemoryAllocator {activeRowsPerColumn[firstSNP].size(), supportsPerSNP[firstSNP].size(), k};
-
-	std::vector<SparsePartition> oldRowPartitions = SparsePartition::getAllPartitions(activeRowsPerColumn[firstSNP], oldRowMemoryAllocator);
-	std::vector<double> oldRowCosts;
-	std::vector<size_t> oldOptimalPartitions;
-	for (size_t i = 0; i < oldRowPartitions.size(); i++)
+	size_t classBest(size_t classNum) const
 	{
-		oldOptimalPartitions.push_back(optimalPartitions.insertPartition(oldRowPartitions[i], firstSNP, activeRowsPerColumn[firstSNP].size()));
+		return table[classes[classNum]];
 	}
-	for (auto x : oldRowPartitions)
+private:
+	size_t findSlot(const SolidPartition& projection, uint64_t hash) const
 	{
-		oldRowCosts.push_back(x.deltaCost(oldColumn, activeRowsPerColumn[firstSNP]));
+		size_t slot = hash & (table.size()-1);
+		while (table[slot] != -1 && (hashes[table[slot]] != hash || Layout::firstDifference(projections[table[slot]].assignments.rawData(), projection.assignments.rawData(), size) != size))
+		{
+			slot = (slot+1) & (table.size()-1);
+		}
+		return slot;
 	}
+	size_t size;
+	TinyVectorMemoryAllocator allocator;
+	std::vector<SolidPartition> projections;
+	std::vector<uint64_t> hashes;
+	std::vector<size_t> table;
+	std::vector<size_t> classes;
+};
 
-	std::set<size_t> all = activeRowsPerColumn[firstSNP];
+//same result as findExtensions on the outputs of splitIntersection, but joins the projections with a hash table instead of sorting both sides
+template <typename Layout>
+std::vector<size_t> findExtensionsByHash(const std::vector<SparsePartition>& oldPartitions, const ActiveRowSet& oldActives, const std::vector<SparsePartition>& newPartitions, const ActiveRowSet& newActives, const ActiveRowSet& intersection, const std::vector<double>& oldCosts, ThreadPool& pool)
+{
+	size_t size = intersection.size();
+	ProjectionClassTable<Layout> classes { oldPartitions, oldActives, intersection, oldCosts, pool };
+	std::vector<size_t> newPickThese = subsetIndices(intersection, newActives);
+	std::vector<size_t> ret;
+	ret.resize(newPartitions.size(), -1);
+	TinyVectorMemoryAllocator newAllocator;
+	pool.forChunks(newPartitions.size(), 1024, [&](size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; i++)
+		{
+			SolidPartition projection = newPartitions[i].getSolidFromIndices(newPickThese, newAllocator);
+			Layout::unpermutate(projection.assignments.rawData(), size, k);
+			ret[i] = classes.find(projection);
+		}
+	});
+	assert(std::none_of(ret.begin(), ret.end(), [](size_t x) { return x == -1; }));
+	return ret;
+}
 
-	for (size_t snp = firstSNP+1; snp < maxSNP; snp++)
+//positions of partitions in the order of SparsePartition::getAllPartitions
+class PartitionRanker
+{
+public:
+	PartitionRanker(size_t length, size_t k) :
+		completions(),
+		length(length),
+		moved(0)
 	{
-		auto newColumnTime = std::chrono::system_clock::now();
-		auto diff = std::chrono::duration_cast<std::chrono::duration<int,std::milli>>(newColumnTime-lastColumnTime);
-		std::set<size_t> intersect = setIntersection(activeRowsPerColumn[snp], activeRowsPerColumn[snp-1]);
-		lastColumnTime = newColumnTime;
-		std::cerr << " " << diff.count() << "ms\n";
-		std::cerr << "column " << snp << " (" << activeRowsPerColumn[snp].size() << ", " << intersect.size() << ")";
-		if (setEqual(activeRowsPerColumn[snp], activeRowsPerColumn[snp-1]))
+		assert(length > 0);
+		//completions[remaining][used] is the number of ways to assign remaining more rows when used sets are already used
+		completions.resize(length);
+		completions[0].resize(k+1, 1);
+		for (size_t remaining = 1; remaining < length; remaining++)
 		{
-			Column col { supportsPerSNP[snp].begin(), supportsPerSNP[snp].end(), snp, 0, maxRead };
-			for (size_t i = 0; i < oldRowCosts.size(); i++)
+			completions[remaining].resize(k+1, 0);
+			for (size_t used = 1; used <= k; used++)
 			{
-				oldRowCosts[i] += oldRowPartitions[i].deltaCost(col, activeRowsPerColumn[snp]);
+				completions[remaining][used] = used*completions[remaining-1][used];
+				if (used < k)
+				{
+					completions[remaining][used] += completions[remaining-1][used+1];
+				}
 			}
-			all = setUnion(all, activeRowsPerColumn[snp]);
-			continue;
-		}
-		TinyVectorMemoryAllocator newRowMemoryAllocator { activeRowsPerColumn[snp].size(), activeRowsPerColumn[snp].size(), k };
-		std::vector<SparsePartition> newRowPartitions = SparsePartition::getAllPartitions(activeRowsPerColumn[snp], newRowMemoryAllocator);
-		std::cerr << " (" << newRowPartitions.size() << " partitions)";
-		std::vector<size_t> optimalExtensions;
-		if (intersect.size() == 0)
-		{
-			optimalExtensions = findOptimalExtensionsWithNoOverlap(newRowPartitions.size(), oldRowCosts);
 		}
-		else
+		//SparsePartition::getAllPartitions moves the lexicographically last partitions to the front in reverse order, about a third of them
+		while (moved < (count()-moved)/2)
 		{
-			TinyVectorMemoryAllocator tempOldRowMemoryAllocator { activeRowsPerColumn[snp-1].size(), intersect.size(), k };
-			auto tempOldRowPartitions = splitIntersection(oldRowPartitions, intersect, activeRowsPerColumn[snp-1], tempOldRowMemoryAllocator);
-			clearVector(oldRowPartitions);
-			oldRowMemoryAllocator.empty();
-			TinyVectorMemoryAllocator tempNewRowMemoryAllocator { activeRowsPerColumn[snp].size(), intersect.size(), k };
-			auto tempNewRowPartitions = splitIntersection(newRowPartitions, intersect, activeRowsPerColumn[snp], tempNewRowMemoryAllocator);
-			optimalExtensions = findExtensions(tempOldRowPartitions, tempNewRowPartitions, intersect.size(), oldRowCosts);
-//			auto extensions = findExtensions(tempOldRowPartitions, tempNewRowPartitions, intersect.size());
-//			auto optimalExtensions2 = findOptimalExtensions(extensions, oldRowCosts);
-//			assert(std::equal(optimalExtensions.begin(), optimalExtensions.end(), optimalExtensions2.begin()));
+			moved++;
 		}
-		Column col { supportsPerSNP[snp].begin(), supportsPerSNP[snp].end(), snp, 0, maxRead };
-		std::vector<double> newRowCosts;
-		std::vector<size_t> newOptimalPartitions;
-		newRowCosts.reserve(newRowPartitions.size());
-		newOptimalPartitions.reserve(newRowPartitions.size());
-		optimalPartitions.reserveMore(optimalExtensions.size()*(activeRowsPerColumn[snp].size()-intersect.size()));
-		for (size_t j = 0; j < optimalExtensions.size(); j++)
+	}
+	size_t count() const
+	{
+		return completions[length-1][1];
+	}
+	//number of ways to assign remaining more rows when used sets are already used
+	size_t completionCount(size_t remaining, size_t used) const
+	{
+		assert(remaining < length);
+		return completions[remaining][used];
+	}
+	size_t rank(const std::vector<size_t>& partition) const
+	{
+		assert(partition.size() == length);
+		assert(partition[0] == 0);
+		size_t ret = 0;
+		size_t used = 1;
+		for (size_t i = 1; i < length; i++)
 		{
-			assert(optimalExtensions[j] < oldOptimalPartitions.size());
-			assert(optimalExtensions[j] < oldRowCosts.size());
-			newRowCosts.push_back(oldRowCosts[optimalExtensions[j]]+newRowPartitions[j].deltaCost(col, activeRowsPerColumn[snp]));
-			newOptimalPartitions.push_back(optimalPartitions.extendPartition(oldOptimalPartitions[optimalExtensions[j]], newRowPartitions[j], snp, maxSNP, all, activeRowsPerColumn[snp], intersect));
+			assert(partition[i] <= used);
+			ret += partition[i]*completions[length-1-i][used];
+			if (partition[i] == used)
+			{
+				used++;
+			}
 		}
-		clearVector(optimalExtensions);
-		optimalPartitions.clearUnused(newOptimalPartitions);
-		oldRowPartitions = std::move(newRowPartitions);
-		oldRowCosts = std::move(newRowCosts);
-		oldOptimalPartitions = std::move(newOptimalPartitions);
-		oldRowMemoryAllocator = std::move(newRowMemoryAllocator);
-		all = setUnion(all, activeRowsPerColumn[snp]);
+		return ret;
 	}
-
-	size_t optimalResultIndex = 0;
-	for (size_t i = 1; i < oldRowCosts.size(); i++)
+	size_t position(const std::vector<size_t>& partition) const
 	{
-		if (oldRowCosts[i] < oldRowCosts[optimalResultIndex])
+		size_t lexicographicRank = rank(partition);
+		if (lexicographicRank >= count()-moved)
 		{
-			optimalResultIndex = i;
+			return count()-1-lexicographicRank;
 		}
+		return moved+lexicographicRank;
 	}
+private:
+	std::vector<std::vector<size_t>> completions;
+	size_t length;
+	size_t moved;
+};
 
-	TinyVectorMemoryAllocator allocator { 2, maxSNP, k };
-	SolidPartition partition = optimalPartitions.getPartition(oldOptimalPartitions[optimalResultIndex], maxSNP, allocator).getSolid(all, allocator);
-	double score = oldRowCosts[optimalResultIndex];
+//where the partitions of each class start if they are placed consecutively, the last element is the number of partitions
+template <typename Layout>
+std::vector<size_t> extensionOffsets(const ProjectionClassTable<Layout>& classes, const ActiveRowSet& actives, const ActiveRowSet& intersection)
+{
+	PartitionRanker ranker { actives.size(), k };
+	std::vector<size_t> ret;
+	ret.push_back(0);
+	for (size_t c = 0; c < classes.numClasses(); c++)
+	{
+		size_t usedSets = 0;
+		for (size_t i = 0; i < intersection.size(); i++)
+		{
+			usedSets = std::max(usedSets, Layout::get(classes.classProjection(c).assignments.rawData(), i)+1);
+		}
+		ret.push_back(ret.back()+ranker.completionCount(actives.size()-intersection.size(), usedSets));
+	}
+	return ret;
+}
+
+//the new partitions with the cheapest old partition with the same projection onto the intersection
+//generated from the classes of the old partitions' projections times the assignments of the new rows, so the new partitions are never projected or joined
+//with empty classOffsets all partitions of actives are generated in the same order as SparsePartition::getAllPartitions(actives),
+//otherwise the classes don't need to cover every partition, classOffsets from extensionOffsets give the number of partitions generated
+//and positions their positions in getAllPartitions, which sortByPosition puts them back in so ties are broken the same way as with every partition
+template <typename Layout>
+void enumerateExtensions(const ProjectionClassTable<Layout>& classes, const ActiveRowSet& actives, const ActiveRowSet& intersection, const std::vector<size_t>& classOffsets, std::vector<SparsePartition>& partitions, std::vector<size_t>& optimalExtensions, std::vector<size_t>& positions, TinyVectorMemoryAllocator& allocator, ThreadPool& pool)
+{
+	size_t size = actives.size();
+	PartitionRanker ranker { size, k };
+	size_t count = classOffsets.size() > 0 ? classOffsets.back() : ranker.count();
+	partitions.resize(count);
+	optimalExtensions.resize(count, -1);
+	positions.clear();
+	if (classOffsets.size() > 0)
+	{
+		positions.resize(count);
+	}
+	std::vector<size_t> oldIndices = subsetIndices(intersection, actives);
+	std::vector<size_t> newIndices;
+	for (size_t i = 0, j = 0; i < size; i++)
+	{
+		if (j < oldIndices.size() && oldIndices[j] == i)
+		{
+			j++;
+		}
+		else
+		{
+			newIndices.push_back(i);
+		}
+	}
+	pool.forChunks(classes.numClasses(), 16, [&](size_t start, size_t end)
+	{
+		std::vector<size_t> merged;
+		merged.resize(size);
+		std::vector<size_t> partition;
+		partition.resize(size);
+		std::vector<size_t> mapping;
+		for (size_t c = start; c < end; c++)
+		{
+			const SolidPartition& projection = classes.classProjection(c);
+			size_t best = classes.classBest(c);
+			//the projection is unpermutated so its sets are 0..usedSets-1 and the prefix below enumerates the new rows' assignments
+			std::vector<size_t> prefix;
+			for (size_t i = 0; i < intersection.size(); i++)
+			{
+				size_t assignment = Layout::get(projection.assignments.rawData(), i);
+				merged[oldIndices[i]] = assignment;
+				if (assignment == prefix.size())
+				{
+					prefix.push_back(assignment);
+				}
+			}
+			size_t usedSets = prefix.size();
+			size_t nextPos = classOffsets.size() > 0 ? classOffsets[c] : 0;
+			forEachPartitionWithPrefix(prefix, usedSets, usedSets+newIndices.size(), k, [&](const std::vector<size_t>& extension)
+			{
+				for (size_t i = 0; i < newIndices.size(); i++)
+				{
+					merged[newIndices[i]] = extension[usedSets+i];
+				}
+				mapping.assign(k, -1);
+				size_t nextNum = 0;
+				for (size_t i = 0; i < size; i++)
+				{
+					if (mapping[merged[i]] == -1)
+					{
+						mapping[merged[i]] = nextNum;
+						nextNum++;
+					}
+					partition[i] = mapping[merged[i]];
+				}
+				size_t pos = ranker.position(partition);
+				if (classOffsets.size() > 0)
+				{
+					positions[nextPos] = pos;
+					pos = nextPos;
+					nextPos++;
+				}
+				assert(pos < count);
+				assert(optimalExtensions[pos] == -1);
+				partitions[pos] = SparsePartition { SolidPartition { partition.begin(), partition.end(), size, allocator } };
+				optimalExtensions[pos] = best;
+			});
+		}
+	});
+	assert(std::none_of(optimalExtensions.begin(), optimalExtensions.end(), [](size_t x) { return x == -1; }));
+}
+
+void sortByPosition(const std::vector<size_t>& positions, std::vector<SparsePartition>& partitions, std::vector<size_t>& optimalExtensions, ThreadPool& pool)
+{
+	assert(positions.size() == partitions.size());
+	std::vector<size_t> order;
+	order.reserve(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		order.push_back(i);
+	}
+	parallelSort(order, [&positions](size_t left, size_t right) { return positions[left] < positions[right]; }, pool, 65536);
+	std::vector<SparsePartition> sortedPartitions;
+	std::vector<size_t> sortedExtensions;
+	sortedPartitions.reserve(order.size());
+	sortedExtensions.reserve(order.size());
+	for (auto i : order)
+	{
+		sortedPartitions.push_back(partitions[i]);
+		sortedExtensions.push_back(optimalExtensions[i]);
+	}
+	partitions = std::move(sortedPartitions);
+	optimalExtensions = std::move(sortedExtensions);
+}
+
+//columns of an in-memory support matrix. only the current column is unpacked
+class SupportMatrixColumnSource
+{
+public:
+	SupportMatrixColumnSource(const SupportMatrix& matrix) :
+		matrix(matrix),
+		currentSupports(),
+		sweep(matrix, true)
+	{
+	}
+	//moves to the next column, the first call moves to column 0. returns false after the last column
+	bool next()
+	{
+		currentSupports.clear();
+		if (!sweep.next())
+		{
+			return false;
+		}
+		for (size_t i = matrix.SNPstart(sweep.SNP()); i < matrix.SNPstart(sweep.SNP()+1); i++)
+		{
+			currentSupports.push_back(matrix[i]);
+		}
+		return true;
+	}
+	size_t SNP() const
+	{
+		return sweep.SNP();
+	}
+	size_t numSNPs() const
+	{
+		return sweep.numSNPs();
+	}
+	const std::vector<SNPSupport>& supports() const
+	{
+		return currentSupports;
+	}
+	ActiveRowSet activeRows() const
+	{
+		return ActiveRowSet { sweep.activeRows() };
+	}
+private:
+	const SupportMatrix& matrix;
+	std::vector<SNPSupport> currentSupports;
+	ActiveRowSweep sweep;
+};
+
+//first SNP of each block when the SNPs are cut between the SNPs which at most maxBridgingRows rows span. the first block starts at 0
+std::vector<size_t> findBlockStarts(const std::vector<std::pair<size_t, size_t>>& rowExtents, size_t numSNPs, size_t maxBridgingRows)
+{
+	//spanning[i] is the number of rows active in both SNP i-1 and SNP i
+	std::vector<int> spanningChange;
+	spanningChange.resize(numSNPs+1, 0);
+	for (auto x : rowExtents)
+	{
+		if (x.first < x.second)
+		{
+			spanningChange[x.first+1]++;
+			spanningChange[x.second+1]--;
+		}
+	}
+	std::vector<size_t> starts;
+	starts.push_back(0);
+	int spanning = 0;
+	for (size_t i = 1; i < numSNPs; i++)
+	{
+		spanning += spanningChange[i];
+		assert(spanning >= 0);
+		if ((size_t)spanning <= maxBridgingRows)
+		{
+			starts.push_back(i);
+		}
+	}
+	return starts;
+}
+
+//columns of a supports file sorted by SNP. the file is read once for the blocks between the SNPs which no row spans, and then twice
+//side by side: ahead for the row extents of one block at a time and behind for the columns, so only the current block's extents are kept
+class SupportFileColumnSource
+{
+public:
+	SupportFileColumnSource(std::string fileName) :
+		reader(fileName),
+		extentReader(fileName),
+		blocks(),
+		nextBlock(0),
+		SNPcount(0),
+		sweep(std::vector<std::pair<size_t, size_t>> {}, 0, true),
+		blockFirstSNP(0),
+		blockFirstRow(0),
+		currentSupports(),
+		lookahead(0, 0, 'A', 0),
+		hasLookahead(false),
+		extentLookahead(0, 0, 'A', 0),
+		hasExtentLookahead(false)
+	{
+		std::vector<std::pair<size_t, size_t>> rowExtents;
+		readExtents(fileName, rowExtents, SNPcount);
+		std::vector<size_t> starts = findBlockStarts(rowExtents, SNPcount, 0);
+		for (size_t i = 0; i < starts.size(); i++)
+		{
+			blocks.push_back(Block { starts[i], i+1 < starts.size() ? starts[i+1]-1 : SNPcount-1, 0, 0 });
+		}
+		for (size_t row = 0; row < rowExtents.size(); row++)
+		{
+			if (rowExtents[row].first > rowExtents[row].second)
+			{
+				continue;
+			}
+			Block& block = blocks[std::upper_bound(starts.begin(), starts.end(), rowExtents[row].first)-starts.begin()-1];
+			assert(rowExtents[row].second <= block.lastSNP);
+			if (block.firstRow == block.rowEnd)
+			{
+				block.firstRow = row;
+			}
+			block.rowEnd = row+1;
+		}
+		hasLookahead = reader.next(lookahead);
+		hasExtentLookahead = extentReader.next(extentLookahead);
+	}
+	bool next()
+	{
+		clearVector(currentSupports);
+		while (!sweep.next())
+		{
+			if (nextBlock == blocks.size())
+			{
+				return false;
+			}
+			readBlock();
+		}
+		while (hasLookahead && lookahead.SNPnum == SNP())
+		{
+			currentSupports.push_back(lookahead);
+			hasLookahead = reader.next(lookahead);
+		}
+		assert(!hasLookahead || lookahead.SNPnum > SNP());
+		return true;
+	}
+	size_t SNP() const
+	{
+		return blockFirstSNP+sweep.SNP();
+	}
+	size_t numSNPs() const
+	{
+		return SNPcount;
+	}
+	const std::vector<SNPSupport>& supports() const
+	{
+		return currentSupports;
+	}
+	ActiveRowSet activeRows() const
+	{
+		std::vector<uint32_t> rows = sweep.activeRows();
+		for (auto& row : rows)
+		{
+			row += blockFirstRow;
+		}
+		return ActiveRowSet { std::move(rows) };
+	}
+	//the row extents of the file in one pass
+	static ActiveRowSweep sweepFile(std::string fileName, bool trackRows)
+	{
+		std::vector<std::pair<size_t, size_t>> rowExtents;
+		size_t numSNPs = 0;
+		readExtents(fileName, rowExtents, numSNPs);
+		return ActiveRowSweep { rowExtents, numSNPs, trackRows };
+	}
+private:
+	//rows firstRow to rowEnd-1 have their supports in the block, and maybe some rows between them without supports
+	class Block
+	{
+	public:
+		size_t firstSNP;
+		size_t lastSNP;
+		size_t firstRow;
+		size_t rowEnd;
+	};
+	static void readExtents(std::string fileName, std::vector<std::pair<size_t, size_t>>& rowExtents, size_t& numSNPs)
+	{
+		SupportFileReader reader { fileName };
+		SNPSupport support { 0, 0, 'A', 0 };
+		numSNPs = 0;
+		while (reader.next(support))
+		{
+			if (support.SNPnum+1 < numSNPs)
+			{
+				throw std::runtime_error { "supports file "+fileName+" is not sorted by SNP" };
+			}
+			numSNPs = std::max(numSNPs, support.SNPnum+1);
+			if (rowExtents.size() <= support.readNum)
+			{
+				rowExtents.resize(support.readNum+1, {-1, 0});
+			}
+			rowExtents[support.readNum].first = std::min(rowExtents[support.readNum].first, support.SNPnum);
+			rowExtents[support.readNum].second = std::max(rowExtents[support.readNum].second, support.SNPnum);
+		}
+	}
+	//the sweep over the next block, with its SNPs and rows counted from its first ones
+	void readBlock()
+	{
+		const Block& block = blocks[nextBlock];
+		nextBlock++;
+		std::vector<std::pair<size_t, size_t>> rowExtents;
+		rowExtents.resize(block.rowEnd-block.firstRow, {-1, 0});
+		while (hasExtentLookahead && extentLookahead.SNPnum <= block.lastSNP)
+		{
+			assert(extentLookahead.readNum >= block.firstRow && extentLookahead.readNum < block.rowEnd);
+			std::pair<size_t, size_t>& extent = rowExtents[extentLookahead.readNum-block.firstRow];
+			extent.first = std::min(extent.first, extentLookahead.SNPnum-block.firstSNP);
+			extent.second = std::max(extent.second, extentLookahead.SNPnum-block.firstSNP);
+			hasExtentLookahead = extentReader.next(extentLookahead);
+		}
+		blockFirstSNP = block.firstSNP;
+		blockFirstRow = block.firstRow;
+		sweep = ActiveRowSweep { rowExtents, block.lastSNP-block.firstSNP+1, true };
+	}
+	SupportFileReader reader;
+	SupportFileReader extentReader;
+	std::vector<Block> blocks;
+	size_t nextBlock;
+	size_t SNPcount;
+	ActiveRowSweep sweep;
+	size_t blockFirstSNP;
+	size_t blockFirstRow;
+	std::vector<SNPSupport> currentSupports;
+	SNPSupport lookahead;
+	bool hasLookahead;
+	SNPSupport extentLookahead;
+	bool hasExtentLookahead;
+};
+
+//groups the columns of a column source into maximal runs with the same active rows, at most maxRunLength columns each
+template <typename ColumnSource>
+class ColumnRunReader
+{
+public:
+	ColumnRunReader(ColumnSource& source, size_t maxRunLength) :
+		source(source),
+		current(),
+		maxRunLength(maxRunLength),
+		hasPending(false)
+	{
+	}
+	//moves to the next run, returns false after the last one
+	bool next()
+	{
+		if (!hasPending)
+		{
+			hasPending = source.next();
+		}
+		if (!hasPending)
+		{
+			return false;
+		}
+		current.firstSNP = source.SNP();
+		current.actives = source.activeRows();
+		current.columns.clear();
+		do
+		{
+			current.lastSNP = source.SNP();
+			current.columns.emplace_back(source.supports().begin(), source.supports().end(), source.SNP(), current.actives.size() > 0 ? current.actives[0] : 0, current.actives.size() > 0 ? current.actives[current.actives.size()-1] : 0);
+			hasPending = source.next();
+		} while (hasPending && current.columns.size() < maxRunLength && source.activeRows() == current.actives);
+		return true;
+	}
+	ColumnRun& run()
+	{
+		return current;
+	}
+private:
+	ColumnSource& source;
+	ColumnRun current;
+	size_t maxRunLength;
+	bool hasPending;
+};
+
+BeamSettings::BeamSettings() :
+	width(0),
+	margin(0),
+	marginLimit(0)
+{
+}
+
+BeamSettings::BeamSettings(size_t width, double margin, size_t marginLimit) :
+	width(width),
+	margin(margin),
+	marginLimit(marginLimit)
+{
+}
+
+CheckpointSettings::CheckpointSettings() :
+	path(),
+	everyColumns(0),
+	everySeconds(0),
+	resume(false)
+{
+}
+
+CheckpointSettings::CheckpointSettings(std::string path, size_t everyColumns, double everySeconds, bool resume) :
+	path(path),
+	everyColumns(everyColumns),
+	everySeconds(everySeconds),
+	resume(resume)
+{
+}
+
+//writes checkpoints on a background thread to path.tmp, which is then renamed over path so a crash never leaves a partial checkpoint
+class CheckpointWriter
+{
+public:
+	CheckpointWriter(std::string path) :
+		path(path),
+		thread(),
+		writing(false)
+	{
+	}
+	~CheckpointWriter()
+	{
+		wait();
+	}
+	//false while the previous checkpoint is still being written
+	bool ready() const
+	{
+		return !writing;
+	}
+	void writeAsync(std::vector<char> bytes)
+	{
+		assert(ready());
+		wait();
+		writing = true;
+		thread = std::thread { [this](std::vector<char> bytes) { writeFile(bytes); writing = false; }, std::move(bytes) };
+	}
+	void writeNow(const std::vector<char>& bytes)
+	{
+		wait();
+		writeFile(bytes);
+	}
+	void wait()
+	{
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+	static bool readFile(std::string fileName, std::vector<char>& bytes)
+	{
+		std::ifstream file { fileName, std::ios::binary };
+		if (!file.good())
+		{
+			return false;
+		}
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+private:
+	void writeFile(const std::vector<char>& bytes)
+	{
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file { tempPath, std::ios::binary | std::ios::trunc };
+			file.write(bytes.data(), bytes.size());
+			if (!file.good())
+			{
+				std::cerr << "could not write checkpoint " << tempPath << "\n";
+				return;
+			}
+		}
+		if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+		{
+			std::cerr << "could not replace checkpoint " << path << "\n";
+		}
+	}
+	std::string path;
+	std::thread thread;
+	std::atomic<bool> writing;
+};
+
+const uint64_t checkpointMagic = 0x3474706b63706168; //"hapckpt4"
+
+//the settings a checkpoint was written with, which must match the run resuming it
+class CheckpointHeader
+{
+public:
+	void write(BinaryWriter& out) const
+	{
+		out.write(checkpointMagic);
+		out.write((uint64_t)k);
+		out.write((uint64_t)numSNPs);
+		out.write((uint64_t)beamWidth);
+		out.write(beamMargin);
+		out.write((uint64_t)beamMarginLimit);
+		out.write(upperBound);
+		out.write((uint64_t)numSolutions);
+	}
+	bool read(BinaryReader& in)
+	{
+		bool magic = in.read<uint64_t>() == checkpointMagic;
+		k = in.read<uint64_t>();
+		numSNPs = in.read<uint64_t>();
+		beamWidth = in.read<uint64_t>();
+		beamMargin = in.read<double>();
+		beamMarginLimit = in.read<uint64_t>();
+		upperBound = in.read<double>();
+		numSolutions = in.read<uint64_t>();
+		return magic && in.good();
+	}
+	bool operator==(const CheckpointHeader& second) const
+	{
+		return k == second.k && numSNPs == second.numSNPs && beamWidth == second.beamWidth && beamMargin == second.beamMargin && beamMarginLimit == second.beamMarginLimit && upperBound == second.upperBound && numSolutions == second.numSolutions;
+	}
+	size_t k;
+	size_t numSNPs;
+	size_t beamWidth;
+	double beamMargin;
+	size_t beamMarginLimit;
+	//of the pruning, infinity without it
+	double upperBound;
+	size_t numSolutions;
+};
+
+TraceSettings::TraceSettings() :
+	path(),
+	quiet(false)
+{
+}
+
+TraceSettings::TraceSettings(std::string path, bool quiet) :
+	path(path),
+	quiet(quiet)
+{
+}
+
+HaplotyperOptions::HaplotyperOptions() :
+	numThreads(1),
+	join(ExtensionJoin::Enumerate),
+	beam(),
+	prune(false),
+	maxBridgingRows(0),
+	checkpoint(),
+	trace()
+{
+}
+
+//milliseconds between consecutive laps on the monotonic clock
+class LapTimer
+{
+public:
+	LapTimer() :
+		last(std::chrono::steady_clock::now())
+	{
+	}
+	double lap()
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<double, std::milli> ret = now-last;
+		last = now;
+		return ret.count();
+	}
+private:
+	std::chrono::steady_clock::time_point last;
+};
+
+//one line of the trace
+class ColumnProfile
+{
+public:
+	ColumnProfile(size_t firstSNP, size_t lastSNP, size_t activeRows, size_t intersection) :
+		firstSNP(firstSNP),
+		lastSNP(lastSNP),
+		activeRows(activeRows),
+		intersection(intersection),
+		partitions(0),
+		kept(0),
+		times(),
+		arenaBytes(0),
+		tracebackBytes(0)
+	{
+		times.fill(0);
+	}
+	enum Phase { Checkpoint, Split, Enumerate, Sort, Join, Cost, Prune, Extend, GC, NumPhases };
+	size_t firstSNP;
+	size_t lastSNP;
+	size_t activeRows;
+	size_t intersection;
+	//generated, and left after the pruning and the beam
+	size_t partitions;
+	size_t kept;
+	std::array<double, NumPhases> times;
+	size_t arenaBytes;
+	size_t tracebackBytes;
+};
+
+//writes the profiles of one DP as they are recorded, with the SNPs counted from firstSNP. nothing is written without a stream
+class ColumnTrace
+{
+public:
+	ColumnTrace() :
+		out(nullptr),
+		json(false),
+		firstSNP(0)
+	{
+	}
+	ColumnTrace(std::ostream& out, bool json, size_t firstSNP) :
+		out(&out),
+		json(json),
+		firstSNP(firstSNP)
+	{
+	}
+	//the trace of a part haplotyped separately whose SNPs start at firstSNP of this one's, written to partOut and appended later
+	ColumnTrace part(std::ostream& partOut, size_t partFirstSNP) const
+	{
+		if (out == nullptr)
+		{
+			return ColumnTrace {};
+		}
+		return ColumnTrace { partOut, json, firstSNP+partFirstSNP };
+	}
+	//the lines written by a part
+	void append(const std::string& lines)
+	{
+		if (out != nullptr)
+		{
+			*out << lines;
+		}
+	}
+	void write(const ColumnProfile& profile)
+	{
+		if (out == nullptr)
+		{
+			return;
+		}
+		if (json)
+		{
+			*out << "{\"firstSNP\":" << firstSNP+profile.firstSNP << ",\"lastSNP\":" << firstSNP+profile.lastSNP << ",\"activeRows\":" << profile.activeRows << ",\"intersection\":" << profile.intersection << ",\"partitions\":" << profile.partitions << ",\"kept\":" << profile.kept;
+			for (size_t i = 0; i < ColumnProfile::NumPhases; i++)
+			{
+				*out << ",\"" << phaseNames[i] << "Ms\":" << profile.times[i];
+			}
+			*out << ",\"arenaBytes\":" << profile.arenaBytes << ",\"tracebackBytes\":" << profile.tracebackBytes << "}\n";
+			return;
+		}
+		*out << firstSNP+profile.firstSNP << "," << firstSNP+profile.lastSNP << "," << profile.activeRows << "," << profile.intersection << "," << profile.partitions << "," << profile.kept;
+		for (size_t i = 0; i < ColumnProfile::NumPhases; i++)
+		{
+			*out << "," << profile.times[i];
+		}
+		*out << "," << profile.arenaBytes << "," << profile.tracebackBytes << "\n";
+	}
+	static void writeHeader(std::ostream& out)
+	{
+		out << "firstSNP,lastSNP,activeRows,intersection,partitions,kept";
+		for (size_t i = 0; i < ColumnProfile::NumPhases; i++)
+		{
+			out << "," << phaseNames[i] << "Ms";
+		}
+		out << ",arenaBytes,tracebackBytes\n";
+	}
+private:
+	static const char* phaseNames[ColumnProfile::NumPhases];
+	std::ostream* out;
+	bool json;
+	size_t firstSNP;
+};
+
+const char* ColumnTrace::phaseNames[ColumnProfile::NumPhases] = { "checkpoint", "split", "enumerate", "sort", "join", "cost", "prune", "extend", "gc" };
+
+//the file of a run's trace, the blocks and windows of the run are all written to it
+class TraceFile
+{
+public:
+	TraceFile(std::string path) :
+		file(),
+		json(path.size() >= 5 && path.substr(path.size()-5) == ".json")
+	{
+		if (path.size() == 0)
+		{
+			return;
+		}
+		file.open(path);
+		if (!file.good())
+		{
+			std::cerr << "could not write trace " << path << "\n";
+			file.close();
+			return;
+		}
+		if (!json)
+		{
+			ColumnTrace::writeHeader(file);
+		}
+	}
+	ColumnTrace trace()
+	{
+		if (!file.is_open())
+		{
+			return ColumnTrace {};
+		}
+		return ColumnTrace { file, json, 0 };
+	}
+private:
+	std::ofstream file;
+	bool json;
+};
+
+//lower bounds for the cost of each column from the weights of its variants alone, whatever the partition
+//a column costs at least the weight of the variants other than the k heaviest, since each set has one variant for free
+class ColumnLowerBounds
+{
+public:
+	ColumnLowerBounds(size_t k) :
+		variantWeights(),
+		integral(),
+		k(k)
+	{
+	}
+	void add(const SNPSupport& support)
+	{
+		if (variantWeights.size() <= support.SNPnum)
+		{
+			variantWeights.resize(support.SNPnum+1, {0, 0, 0, 0});
+			integral.resize(support.SNPnum+1, true);
+		}
+		switch(support.variant)
+		{
+			case 'A':
+				variantWeights[support.SNPnum][0] += support.support;
+				break;
+			case 'T':
+				variantWeights[support.SNPnum][1] += support.support;
+				break;
+			case 'C':
+				variantWeights[support.SNPnum][2] += support.support;
+				break;
+			case 'G':
+				variantWeights[support.SNPnum][3] += support.support;
+				break;
+			default:
+				return;
+		}
+		if (support.support != floor(support.support))
+		{
+			integral[support.SNPnum] = false;
+		}
+	}
+	//remaining[i] bounds the total cost of the columns after column i
+	std::vector<double> remaining(size_t numSNPs) const
+	{
+		std::vector<double> ret;
+		ret.resize(numSNPs, 0);
+		for (size_t i = numSNPs; i > 1; i--)
+		{
+			ret[i-2] = ret[i-1]+columnBound(i-1);
+		}
+		return ret;
+	}
+private:
+	double columnBound(size_t SNP) const
+	{
+		if (SNP >= variantWeights.size())
+		{
+			return 0;
+		}
+		std::array<double, 4> weights = variantWeights[SNP];
+		std::sort(weights.begin(), weights.end());
+		double bound = 0;
+		for (size_t j = 0; j+k < 4; j++)
+		{
+			bound += weights[j];
+		}
+		//the cost of each set is truncated, which loses less than one per set unless the weights are integers
+		if (!integral[SNP])
+		{
+			bound = std::max(floor(bound)-(double)(k-1), 0.0);
+		}
+		return bound;
+	}
+	std::vector<std::array<double, 4>> variantWeights;
+	std::vector<bool> integral;
+	size_t k;
+};
+
+//beam width of the solution whose score is the upper bound for branch and bound
+const size_t pruningBeamWidth = 256;
+
+//branch and bound: a partition whose cost plus a lower bound for the remaining columns is more than the score of a known solution can't be on an optimal path
+//without a known solution only the lower bounds are kept, for the beam's bound on the optimal score
+class PruningBounds
+{
+public:
+	PruningBounds() :
+		upperBound(std::numeric_limits<double>::infinity()),
+		remaining()
+	{
+	}
+	PruningBounds(double upperBound, std::vector<double> remaining) :
+		upperBound(upperBound),
+		remaining(std::move(remaining))
+	{
+	}
+	bool enabled() const
+	{
+		return upperBound != std::numeric_limits<double>::infinity();
+	}
+	//bound for the cost of the columns after lastSNP, 0 without the lower bounds
+	double remainingAfter(size_t lastSNP) const
+	{
+		return lastSNP < remaining.size() ? remaining[lastSNP] : 0;
+	}
+	//indices of the partitions which may still be optimal after lastSNP, in increasing order
+	std::vector<size_t> keptIndices(const std::vector<double>& costs, size_t lastSNP) const
+	{
+		assert(lastSNP < remaining.size());
+		std::vector<size_t> ret;
+		for (size_t i = 0; i < costs.size(); i++)
+		{
+			if (costs[i]+remaining[lastSNP] <= upperBound)
+			{
+				ret.push_back(i);
+			}
+		}
+		assert(ret.size() > 0);
+		return ret;
+	}
+	double upperBound;
+	std::vector<double> remaining;
+};
+
+//indices of the partitions kept by the beam in increasing order. cheapestDropped is lowered to the cost of the cheapest partition which isn't kept
+std::vector<size_t> beamSelect(const std::vector<double>& costs, const BeamSettings& beam, double& cheapestDropped)
+{
+	std::vector<size_t> order;
+	order.reserve(costs.size());
+	for (size_t i = 0; i < costs.size(); i++)
+	{
+		order.push_back(i);
+	}
+	//ties by index so the kept partitions don't depend on the number of threads
+	auto cheaper = [&costs](size_t left, size_t right) { return costs[left] < costs[right] || (costs[left] == costs[right] && left < right); };
+	size_t candidates = std::min(beam.width+beam.marginLimit, costs.size());
+	if (candidates < costs.size())
+	{
+		std::nth_element(order.begin(), order.begin()+candidates, order.end(), cheaper);
+	}
+	std::sort(order.begin(), order.begin()+candidates, cheaper);
+	size_t kept = std::min(beam.width, candidates);
+	while (kept < candidates && costs[order[kept]] <= costs[order[0]]+beam.margin)
+	{
+		kept++;
+	}
+	if (kept < costs.size())
+	{
+		cheapestDropped = std::min(cheapestDropped, costs[order[kept]]);
+	}
+	order.resize(kept);
+	std::sort(order.begin(), order.end());
+	return order;
+}
+
+//lower bound for the optimal score of a beam run. the blocks are independent, so it is the sum of a bound for each block: its score,
+//or less when a partition dropped in the block costs less than that with the lower bounds for the block's remaining columns
+class BeamLowerBound
+{
+public:
+	BeamLowerBound() :
+		finishedBlocks(0),
+		blockBase(0),
+		cheapestDropped(std::numeric_limits<double>::infinity())
+	{
+	}
+	//the cheapest partition dropped after lastSNP costs cost
+	void dropped(double cost, size_t lastSNP, const PruningBounds& bounds)
+	{
+		cheapestDropped = std::min(cheapestDropped, cost+bounds.remainingAfter(lastSNP));
+	}
+	//the block ending at lastSNP costs cost with the previous blocks, the next block starts from it
+	void finishBlock(double cost, size_t lastSNP, const PruningBounds& bounds)
+	{
+		finishedBlocks += blockBound(cost, lastSNP, bounds);
+		blockBase = cost;
+		cheapestDropped = std::numeric_limits<double>::infinity();
+	}
+	//the bound when the last block ends at lastSNP costing cost with the previous blocks
+	double bound(double cost, size_t lastSNP, const PruningBounds& bounds) const
+	{
+		return finishedBlocks+blockBound(cost, lastSNP, bounds);
+	}
+	void write(BinaryWriter& out) const
+	{
+		out.write(finishedBlocks);
+		out.write(blockBase);
+		out.write(cheapestDropped);
+	}
+	void read(BinaryReader& in)
+	{
+		finishedBlocks = in.read<double>();
+		blockBase = in.read<double>();
+		cheapestDropped = in.read<double>();
+	}
+private:
+	double blockBound(double cost, size_t lastSNP, const PruningBounds& bounds) const
+	{
+		return std::min(cost, cheapestDropped-bounds.remainingAfter(lastSNP))-blockBase;
+	}
+	//sum of the bounds of the finished blocks
+	double finishedBlocks;
+	//cost of the finished blocks the current block's costs start from
+	double blockBase;
+	//of the current block, with the lower bounds for the columns after the dropped partition
+	double cheapestDropped;
+};
+
+//drops the partitions outside the beam and copies the kept ones to a new allocator
+//returns the indices of the kept partitions
+std::vector<size_t> pruneToBeam(std::vector<SparsePartition>& partitions, std::vector<double>& costs, std::vector<size_t>& nodes, TinyVectorMemoryAllocator& allocator, size_t size, const BeamSettings& beam, double& cheapestDropped)
+{
+	std::vector<size_t> kept = beamSelect(costs, beam, cheapestDropped);
+	if (kept.size() == costs.size())
+	{
+		return kept;
+	}
+	TinyVectorMemoryAllocator keptAllocator;
+	std::vector<SparsePartition> keptPartitions;
+	keptPartitions.reserve(kept.size());
+	for (auto i : kept)
+	{
+		const PartitionAssignments& assignments = partitions[i].inner.assignments;
+		keptPartitions.emplace_back(SolidPartition { assignments.begin(), assignments.end(size), size, keptAllocator });
+	}
+	keepIndices(costs, kept);
+	keepIndices(nodes, kept);
+	partitions = std::move(keptPartitions);
+	allocator = std::move(keptAllocator);
+	return kept;
+}
+
+//FNV-1a over the columns of a run, so a checkpoint is only resumed on the same columns
+uint64_t hashColumns(uint64_t hash, const ColumnRun& run)
+{
+	auto add = [&hash](const void* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ ((const unsigned char*)data)[i]) * 0x100000001b3;
+		}
+	};
+	for (const Column& column : run.columns)
+	{
+		add(&column.minRow, sizeof(size_t));
+		add(column.variants.data(), column.variants.size());
+		add(column.costs.data(), column.costs.size()*sizeof(double));
+	}
+	return hash;
+}
+
+const uint64_t emptyColumnsHash = 0xcbf29ce484222325;
+
+//a checkpoint is the header, the last SNP and the hash of the columns up to it, whether the run finished and then either the result or the state between two columns
+std::vector<char> resultCheckpoint(const CheckpointHeader& header, size_t lastSNP, uint64_t columnsHash, const HaplotypeAlternatives& result)
+{
+	BinaryWriter out;
+	header.write(out);
+	out.write((uint64_t)lastSNP);
+	out.write(columnsHash);
+	out.write((uint8_t)1);
+	out.write((uint64_t)result.solutions.size());
+	for (const auto& solution : result.solutions)
+	{
+		out.write(std::get<0>(solution));
+		out.write(std::get<1>(solution));
+	}
+	out.write(result.margins);
+	return std::move(out.bytes);
+}
+
+template <typename Layout>
+std::vector<char> frontierCheckpoint(const CheckpointHeader& header, size_t lastSNP, uint64_t columnsHash, size_t numAll, size_t numPruned, const BeamLowerBound& beamBound, const std::vector<size_t>& finishedAssignments, size_t numFinishedBlocks, size_t blockFirstRow, const ActiveRowSet& actives, const std::vector<SparsePartition>& partitions, const std::vector<double>& costs, const std::vector<size_t>& nodes, const SparsePartitionContainer& traceback)
+{
+	BinaryWriter out;
+	header.write(out);
+	out.write((uint64_t)lastSNP);
+	out.write(columnsHash);
+	out.write((uint8_t)0);
+	out.write((uint64_t)numAll);
+	out.write((uint64_t)numPruned);
+	beamBound.write(out);
+	out.write(finishedAssignments);
+	out.write((uint64_t)numFinishedBlocks);
+	out.write((uint64_t)blockFirstRow);
+	out.write(std::vector<uint32_t> { actives.begin(), actives.end() });
+	//the partitions packed back to back
+	size_t bytesPerPartition = (actives.size()*Layout::bits()+7)/8;
+	std::vector<unsigned char> assignments;
+	assignments.reserve(partitions.size()*bytesPerPartition);
+	for (const SparsePartition& partition : partitions)
+	{
+		const unsigned char* data = partition.inner.assignments.rawData();
+		assignments.insert(assignments.end(), data, data+bytesPerPartition);
+	}
+	out.write(assignments);
+	out.write(costs);
+	out.write(nodes);
+	traceback.write(out);
+	return std::move(out.bytes);
+}
+
+template <typename Layout>
+bool readFrontierCheckpoint(BinaryReader& in, size_t& numAll, size_t& numPruned, BeamLowerBound& beamBound, std::vector<size_t>& finishedAssignments, size_t& numFinishedBlocks, size_t& blockFirstRow, ActiveRowSet& actives, std::vector<SparsePartition>& partitions, std::vector<double>& costs, std::vector<size_t>& nodes, TinyVectorMemoryAllocator& allocator, SparsePartitionContainer& traceback)
+{
+	numAll = in.read<uint64_t>();
+	numPruned = in.read<uint64_t>();
+	beamBound.read(in);
+	finishedAssignments = in.readVector<size_t>();
+	numFinishedBlocks = in.read<uint64_t>();
+	blockFirstRow = in.read<uint64_t>();
+	actives = ActiveRowSet { in.readVector<uint32_t>() };
+	std::vector<unsigned char> assignments = in.readVector<unsigned char>();
+	costs = in.readVector<double>();
+	nodes = in.readVector<size_t>();
+	size_t bytesPerPartition = (actives.size()*Layout::bits()+7)/8;
+	if (!in.good() || actives.size() == 0 || costs.size() != nodes.size() || assignments.size() != costs.size()*bytesPerPartition)
+	{
+		return false;
+	}
+	std::vector<size_t> values;
+	values.resize(actives.size());
+	partitions.clear();
+	partitions.reserve(costs.size());
+	for (size_t i = 0; i < costs.size(); i++)
+	{
+		for (size_t j = 0; j < values.size(); j++)
+		{
+			values[j] = Layout::get(assignments.data()+i*bytesPerPartition, j);
+		}
+		partitions.emplace_back(SolidPartition { values.begin(), values.end(), values.size(), allocator });
+	}
+	return traceback.read(in);
+}
+
+//the kept partitions of every column run of a DP, their costs and which partitions of the previous run they extend. a backward pass over them
+//gives the cost of the cheapest haplotyping through each partition, from which come the alternatives and the margins of haplotypeAlternatives
+//only recorded when alternatives are asked for, since it grows with the number of columns
+template <typename Layout>
+class ColumnHistory
+{
+public:
+	//parents are the partitions of the previous run each one extends, empty when the run starts a block
+	void add(const ActiveRowSet& actives, const std::vector<SparsePartition>& partitions, const std::vector<double>& costs, const std::vector<size_t>& parents)
+	{
+		assert(parents.size() == 0 || parents.size() == costs.size());
+		steps.emplace_back();
+		Step& step = steps.back();
+		step.actives.assign(actives.begin(), actives.end());
+		step.bytesPerPartition = (actives.size()*Layout::bits()+7)/8;
+		step.assignments.reserve(partitions.size()*step.bytesPerPartition);
+		for (const SparsePartition& partition : partitions)
+		{
+			const unsigned char* data = partition.inner.assignments.rawData();
+			step.assignments.insert(step.assignments.end(), data, data+step.bytesPerPartition);
+		}
+		step.costs = costs;
+		step.parents = parents;
+	}
+	//keeps only the given partitions of the last run, in increasing order
+	void keep(const std::vector<size_t>& kept)
+	{
+		Step& step = steps.back();
+		if (kept.size() == step.costs.size())
+		{
+			return;
+		}
+		std::vector<unsigned char> assignments;
+		assignments.reserve(kept.size()*step.bytesPerPartition);
+		for (auto i : kept)
+		{
+			assignments.insert(assignments.end(), step.assignments.begin()+i*step.bytesPerPartition, step.assignments.begin()+(i+1)*step.bytesPerPartition);
+		}
+		step.assignments = std::move(assignments);
+		keepIndices(step.costs, kept);
+		if (step.parents.size() > 0)
+		{
+			keepIndices(step.parents, kept);
+		}
+	}
+	//the costs of the last run's partitions after a run with the same rows
+	void setCosts(const std::vector<double>& costs)
+	{
+		assert(costs.size() == steps.back().costs.size());
+		steps.back().costs = costs;
+	}
+	//appends to solutions, which holds the optimal haplotyping, the next cheapest haplotypings until there are numSolutions, cheapest first
+	//margins[row] is how much more than the optimal one the cheapest haplotyping costs which puts the row with other rows in some column,
+	//infinite when none does. only the kept partitions are in the history, so with the beam or the pruning both only cover those
+	void findAlternatives(size_t numRows, size_t numSolutions, std::vector<std::tuple<std::vector<size_t>, double>>& solutions, std::vector<double>& margins)
+	{
+		margins.assign(numRows, std::numeric_limits<double>::infinity());
+		if (steps.size() == 0)
+		{
+			return;
+		}
+		backward();
+		std::vector<size_t> optimal = optimalPath();
+		double score = steps.back().costs[optimal.back()];
+		std::vector<size_t> labels;
+		std::vector<size_t> optimalLabels;
+		std::vector<size_t> together;
+		std::vector<size_t> setSizes;
+		std::vector<size_t> optimalSetSizes;
+		for (const Step& step : steps)
+		{
+			getLabels(step, optimal[&step-steps.data()], optimalLabels);
+			for (size_t p = 0; p < step.costs.size(); p++)
+			{
+				double through = step.costs[p]+step.remaining[p];
+				if (through == std::numeric_limits<double>::infinity())
+				{
+					continue;
+				}
+				//a row is with the same rows in both partitions when its set in one is all of its set in the other
+				getLabels(step, p, labels);
+				together.assign(k*k, 0);
+				setSizes.assign(k, 0);
+				optimalSetSizes.assign(k, 0);
+				for (size_t j = 0; j < labels.size(); j++)
+				{
+					together[labels[j]*k+optimalLabels[j]]++;
+					setSizes[labels[j]]++;
+					optimalSetSizes[optimalLabels[j]]++;
+				}
+				for (size_t j = 0; j < labels.size(); j++)
+				{
+					size_t shared = together[labels[j]*k+optimalLabels[j]];
+					if (shared != setSizes[labels[j]] || shared != optimalSetSizes[optimalLabels[j]])
+					{
+						margins[step.actives[j]] = std::min(margins[step.actives[j]], std::max(through-score, 0.0));
+					}
+				}
+			}
+		}
+		//best first search over the paths through the steps. a node is a path up to one of the partitions extending the same class, standing for
+		//that path continued with the cheapest partitions to the end. a popped node is such a full path, and each partition along it adds the
+		//path with the next partition of its class instead. the remaining costs are exact so the paths come cheapest first, one per node popped
+		std::vector<SearchNode> nodes;
+		std::priority_queue<std::pair<double, size_t>, std::vector<std::pair<double, size_t>>, std::greater<std::pair<double, size_t>>> queue;
+		auto push = [&](size_t step, size_t projectionClass, size_t rank, size_t previous)
+		{
+			const Step& next = steps[step];
+			if (next.classStarts[projectionClass]+rank >= next.classStarts[projectionClass+1])
+			{
+				return;
+			}
+			size_t partition = next.classOrder[next.classStarts[projectionClass]+rank];
+			double cost = (previous == (size_t)-1 ? 0 : nodes[previous].cost)+stepCost(step, partition);
+			if (cost+next.remaining[partition] == std::numeric_limits<double>::infinity())
+			{
+				return;
+			}
+			nodes.push_back(SearchNode { cost, step, projectionClass, rank, partition, previous });
+			queue.emplace(cost+next.remaining[partition], nodes.size()-1);
+		};
+		push(0, 0, 0, -1);
+		std::vector<size_t> path;
+		path.resize(steps.size());
+		while (queue.size() > 0 && solutions.size() < numSolutions)
+		{
+			size_t last = queue.top().second;
+			queue.pop();
+			while (true)
+			{
+				SearchNode node = nodes[last];
+				push(node.step, node.projectionClass, node.rank+1, node.previous);
+				if (node.step+1 == steps.size())
+				{
+					break;
+				}
+				const Step& next = steps[node.step+1];
+				size_t projectionClass = next.previousClasses.size() == 0 ? 0 : next.previousClasses[node.partition];
+				size_t partition = next.classOrder[next.classStarts[projectionClass]];
+				nodes.push_back(SearchNode { node.cost+stepCost(node.step+1, partition), node.step+1, projectionClass, 0, partition, last });
+				last = nodes.size()-1;
+			}
+			for (size_t i = last; i != (size_t)-1; i = nodes[i].previous)
+			{
+				path[nodes[i].step] = nodes[i].partition;
+			}
+			//the optimal one is already there, from the traceback
+			if (path != optimal)
+			{
+				solutions.emplace_back(getAssignment(path, numRows), nodes[last].cost);
+			}
+		}
+	}
+private:
+	class Step
+	{
+	public:
+		std::vector<uint32_t> actives;
+		size_t bytesPerPartition;
+		//the partitions packed back to back
+		std::vector<unsigned char> assignments;
+		std::vector<double> costs;
+		std::vector<size_t> parents;
+		//set by the backward pass. the cost of the cheapest way from each partition to the end of the columns
+		std::vector<double> remaining;
+		//class of each partition of the previous step by its sets on the rows it shares with this one, empty when this step starts a block
+		std::vector<size_t> previousClasses;
+		//the partitions of this step extending each class, cheapest to the end first. all partitions are in one class when this step starts a block
+		std::vector<size_t> classStarts;
+		std::vector<size_t> classOrder;
+	};
+	class SearchNode
+	{
+	public:
+		//of the path up to and including partition
+		double cost;
+		size_t step;
+		size_t projectionClass;
+		size_t rank;
+		size_t partition;
+		size_t previous;
+	};
+	//first index of the smallest value
+	static size_t cheapest(const std::vector<double>& values)
+	{
+		assert(values.size() > 0);
+		size_t best = 0;
+		for (size_t i = 1; i < values.size(); i++)
+		{
+			if (values[i] < values[best])
+			{
+				best = i;
+			}
+		}
+		return best;
+	}
+	//the cost of partition's columns, which doesn't depend on the partition before it. a block starts from the previous block's optimum
+	double stepCost(size_t s, size_t partition) const
+	{
+		const Step& step = steps[s];
+		if (s == 0)
+		{
+			return step.costs[partition];
+		}
+		const Step& previous = steps[s-1];
+		if (step.parents.size() == 0)
+		{
+			return step.costs[partition]-previous.costs[cheapest(previous.costs)];
+		}
+		return step.costs[partition]-previous.costs[step.parents[partition]];
+	}
+	void getLabels(const Step& step, size_t partition, std::vector<size_t>& labels) const
+	{
+		labels.resize(step.actives.size());
+		const unsigned char* data = step.assignments.data()+partition*step.bytesPerPartition;
+		for (size_t j = 0; j < labels.size(); j++)
+		{
+			labels[j] = Layout::get(data, j);
+			assert(labels[j] < k);
+		}
+	}
+	//the partitions of step s-1 numbered by their sets on the rows shared with step s, in order of first appearance
+	std::vector<size_t> projectionClasses(size_t s) const
+	{
+		const Step& previous = steps[s-1];
+		const Step& step = steps[s];
+		std::vector<size_t> positions;
+		for (size_t i = 0, j = 0; i < previous.actives.size() && j < step.actives.size(); )
+		{
+			if (previous.actives[i] == step.actives[j])
+			{
+				positions.push_back(i);
+				i++;
+				j++;
+			}
+			else if (previous.actives[i] < step.actives[j])
+			{
+				i++;
+			}
+			else
+			{
+				j++;
+			}
+		}
+		std::unordered_map<std::string, size_t> classes;
+		std::vector<size_t> ret;
+		ret.reserve(previous.costs.size());
+		std::vector<size_t> labels;
+		std::string projection;
+		projection.resize(positions.size());
+		std::vector<size_t> renumbering;
+		for (size_t p = 0; p < previous.costs.size(); p++)
+		{
+			getLabels(previous, p, labels);
+			renumbering.assign(k, -1);
+			size_t numSets = 0;
+			for (size_t i = 0; i < positions.size(); i++)
+			{
+				size_t label = labels[positions[i]];
+				if (renumbering[label] == (size_t)-1)
+				{
+					renumbering[label] = numSets;
+					numSets++;
+				}
+				projection[i] = (char)renumbering[label];
+			}
+			auto found = classes.emplace(projection, classes.size());
+			ret.push_back(found.first->second);
+		}
+		return ret;
+	}
+	void backward()
+	{
+		steps.back().remaining.assign(steps.back().costs.size(), 0);
+		for (size_t s = steps.size()-1; s < steps.size(); s--)
+		{
+			Step& step = steps[s];
+			size_t numClasses = 1;
+			if (step.parents.size() > 0)
+			{
+				step.previousClasses = projectionClasses(s);
+				numClasses = *std::max_element(step.previousClasses.begin(), step.previousClasses.end())+1;
+			}
+			//the partition a class continues with is the class of the partition it extends, it is compatible with all of them
+			std::vector<size_t> classOf;
+			classOf.resize(step.costs.size(), 0);
+			step.classStarts.assign(numClasses+1, 0);
+			for (size_t q = 0; q < step.costs.size(); q++)
+			{
+				if (step.parents.size() > 0)
+				{
+					classOf[q] = step.previousClasses[step.parents[q]];
+				}
+				step.classStarts[classOf[q]+1]++;
+			}
+			for (size_t c = 0; c < numClasses; c++)
+			{
+				step.classStarts[c+1] += step.classStarts[c];
+			}
+			std::vector<double> toEnd;
+			toEnd.resize(step.costs.size());
+			step.classOrder.resize(step.costs.size());
+			std::vector<size_t> positions { step.classStarts.begin(), step.classStarts.end()-1 };
+			for (size_t q = 0; q < step.costs.size(); q++)
+			{
+				toEnd[q] = stepCost(s, q)+step.remaining[q];
+				step.classOrder[positions[classOf[q]]] = q;
+				positions[classOf[q]]++;
+			}
+			for (size_t c = 0; c < numClasses; c++)
+			{
+				std::stable_sort(step.classOrder.begin()+step.classStarts[c], step.classOrder.begin()+step.classStarts[c+1], [&toEnd](size_t left, size_t right) { return toEnd[left] < toEnd[right]; });
+			}
+			if (s == 0)
+			{
+				break;
+			}
+			Step& previous = steps[s-1];
+			previous.remaining.resize(previous.costs.size());
+			for (size_t p = 0; p < previous.costs.size(); p++)
+			{
+				size_t c = step.parents.size() > 0 ? step.previousClasses[p] : 0;
+				previous.remaining[p] = step.classStarts[c] < step.classStarts[c+1] ? toEnd[step.classOrder[step.classStarts[c]]] : std::numeric_limits<double>::infinity();
+			}
+		}
+	}
+	//the partitions of the traceback's optimal haplotyping, whose ties are broken by index
+	std::vector<size_t> optimalPath() const
+	{
+		std::vector<size_t> path;
+		path.resize(steps.size());
+		path.back() = cheapest(steps.back().costs);
+		for (size_t s = steps.size()-1; s > 0; s--)
+		{
+			path[s-1] = steps[s].parents.size() == 0 ? cheapest(steps[s-1].costs) : steps[s].parents[path[s]];
+		}
+		return path;
+	}
+	//the sets of the path's partitions, numbered to agree with the rows each step shares with the previous one
+	std::vector<size_t> getAssignment(const std::vector<size_t>& path, size_t numRows) const
+	{
+		std::vector<size_t> result;
+		result.resize(numRows, 0);
+		std::vector<bool> assigned;
+		assigned.resize(numRows, false);
+		std::vector<size_t> labels;
+		std::vector<size_t> numbering;
+		std::vector<bool> used;
+		for (size_t s = 0; s < steps.size(); s++)
+		{
+			const Step& step = steps[s];
+			getLabels(step, path[s], labels);
+			numbering.assign(k, -1);
+			used.assign(k, false);
+			for (size_t j = 0; j < labels.size(); j++)
+			{
+				if (assigned[step.actives[j]])
+				{
+					assert(numbering[labels[j]] == (size_t)-1 || numbering[labels[j]] == result[step.actives[j]]);
+					numbering[labels[j]] = result[step.actives[j]];
+					used[result[step.actives[j]]] = true;
+				}
+			}
+			size_t unused = 0;
+			for (size_t label = 0; label < k; label++)
+			{
+				if (numbering[label] != (size_t)-1)
+				{
+					continue;
+				}
+				while (used[unused])
+				{
+					unused++;
+				}
+				numbering[label] = unused;
+				used[unused] = true;
+			}
+			for (size_t j = 0; j < labels.size(); j++)
+			{
+				if (!assigned[step.actives[j]])
+				{
+					result[step.actives[j]] = numbering[labels[j]];
+					assigned[step.actives[j]] = true;
+				}
+			}
+		}
+		return result;
+	}
+	std::vector<Step> steps;
+};
+
+//the DP over the columns given by source. only the partitions of the previous and current column and the traceback are kept
+//a column with rows but none in common with the previous column with rows starts a new block. the previous block's cheapest partition
+//is traced back and the DP starts again from its cost, so the traceback only holds the current block
+//returns the optimal haplotyping. with numSolutions above 1 the kept partitions of every column are recorded too, and numSolutions-1 alternatives and
+//the margins of the rows are found from them as in ColumnHistory. the checkpoints of such a run only hold its result
+//the pool, arenas and traceback of workspace are reused, their previous contents are dropped
+template <typename Layout, typename ColumnSource>
+HaplotypeAlternatives haplotypeColumns(ColumnSource& source, DPWorkspace& workspace, ExtensionJoin join, const BeamSettings& beam, const PruningBounds& bounds, size_t numSolutions, const CheckpointSettings& checkpoint, bool quiet, ColumnTrace& columnTrace, std::ostream& log)
+{
+	ThreadPool& pool = workspace.pool;
+	std::chrono::duration<double, std::milli> joinTime { 0 };
+	//the optimal path is either kept to the end or has a dropped partition, whose cost with the lower bounds of the remaining columns can't be more than the optimal score
+	BeamLowerBound beamBound;
+	//the other joins match every partition of the new column with the old ones
+	if (beam.width > 0 || bounds.enabled())
+	{
+		join = ExtensionJoin::Enumerate;
+	}
+	size_t maxSNP = source.numSNPs();
+	SparsePartitionContainer& optimalPartitions = workspace.traceback;
+	optimalPartitions.clear();
+	//a stream without a buffer drops everything written to it
+	std::ostream quietLog { nullptr };
+	std::ostream& columnLog = quiet ? quietLog : log;
+
+	ColumnRunReader<ColumnSource> runs { source, 1024 };
+	//two arenas which swap roles every column, so their slabs are reused instead of allocated again
+	TinyVectorMemoryAllocator& oldRowMemoryAllocator = workspace.oldRowMemoryAllocator;
+	TinyVectorMemoryAllocator& newRowMemoryAllocator = workspace.newRowMemoryAllocator;
+	oldRowMemoryAllocator.reset();
+	newRowMemoryAllocator.reset();
+	//rows of the last column with rows, empty before the first one
+	ActiveRowSet oldActives;
+	std::vector<SparsePartition> oldRowPartitions;
+	std::vector<double> oldRowCosts;
+	std::vector<size_t> oldOptimalPartitions;
+	size_t numPruned = 0;
+	//rows seen so far. rows are active in a consecutive range of columns so a row which isn't in the previous column is new
+	size_t numAll = 0;
+	//the rows of the finished blocks in their cheapest partitions
+	std::vector<size_t> finishedAssignments;
+	size_t numFinishedBlocks = 0;
+	//rows seen before the current block
+	size_t blockFirstRow = 0;
+	//last SNP of the columns in the partitions
+	size_t lastSNP = 0;
+	uint64_t columnsHash = emptyColumnsHash;
+	std::unique_ptr<ColumnHistory<Layout>> history;
+	if (numSolutions > 1)
+	{
+		history.reset(new ColumnHistory<Layout>);
+	}
+
+	CheckpointHeader header { k, maxSNP, beam.width, beam.margin, beam.marginLimit, bounds.enabled() ? bounds.upperBound : std::numeric_limits<double>::infinity(), numSolutions };
+	bool resumed = false;
+	if (checkpoint.resume)
+	{
+		std::vector<char> bytes;
+		if (CheckpointWriter::readFile(checkpoint.path, bytes))
+		{
+			BinaryReader in { std::move(bytes) };
+			CheckpointHeader written;
+			bool matches = written.read(in) && written == header;
+			lastSNP = in.read<uint64_t>();
+			uint64_t writtenHash = in.read<uint64_t>();
+			//the runs are the same as in the checkpointed run, so the next one starts after lastSNP
+			bool hasRun = matches && runs.next();
+			while (hasRun)
+			{
+				columnsHash = hashColumns(columnsHash, runs.run());
+				if (runs.run().lastSNP >= lastSNP)
+				{
+					break;
+				}
+				hasRun = runs.next();
+			}
+			if (!hasRun || runs.run().lastSNP != lastSNP || columnsHash != writtenHash)
+			{
+				throw std::runtime_error { "checkpoint "+checkpoint.path+" is not from a run with the same supports and settings" };
+			}
+			if (in.read<uint8_t>() == 1)
+			{
+				HaplotypeAlternatives result;
+				result.solutions.resize(in.read<uint64_t>());
+				for (auto& solution : result.solutions)
+				{
+					std::get<0>(solution) = in.readVector<size_t>();
+					std::get<1>(solution) = in.read<double>();
+				}
+				result.margins = in.readVector<double>();
+				if (!in.good() || result.solutions.size() == 0)
+				{
+					throw std::runtime_error { "checkpoint "+checkpoint.path+" is truncated" };
+				}
+				log << "finished run resumed from checkpoint " << checkpoint.path << "\n";
+				return result;
+			}
+			assert(history == nullptr);
+			if (!readFrontierCheckpoint<Layout>(in, numAll, numPruned, beamBound, finishedAssignments, numFinishedBlocks, blockFirstRow, oldActives, oldRowPartitions, oldRowCosts, oldOptimalPartitions, oldRowMemoryAllocator, optimalPartitions))
+			{
+				throw std::runtime_error { "checkpoint "+checkpoint.path+" is truncated" };
+			}
+			oldActives.buildRankIndex();
+			columnLog << "resumed from checkpoint " << checkpoint.path << " after column " << lastSNP << " (" << oldRowPartitions.size() << " partitions)";
+			resumed = true;
+		}
+	}
+
+	//the old partitions become every partition of run's rows, costing the previous blocks' optimum more
+	auto startBlock = [&](ColumnRun& run, ColumnProfile& profile, LapTimer& timer)
+	{
+		double baseCost = 0;
+		if (oldActives.size() > 0)
+		{
+			//ties broken by index like the result
+			size_t best = 0;
+			for (size_t i = 1; i < oldRowCosts.size(); i++)
+			{
+				if (oldRowCosts[i] < oldRowCosts[best])
+				{
+					best = i;
+				}
+			}
+			optimalPartitions.getAssignments(oldOptimalPartitions[best], finishedAssignments);
+			baseCost = oldRowCosts[best];
+			beamBound.finishBlock(baseCost, run.firstSNP-1, bounds);
+			numFinishedBlocks++;
+			clearVector(oldRowPartitions);
+			oldRowMemoryAllocator.reset();
+			oldRowCosts.clear();
+			oldOptimalPartitions.clear();
+			optimalPartitions.restart();
+			profile.times[ColumnProfile::GC] += timer.lap();
+		}
+		for (size_t snp = run.firstSNP; snp <= run.lastSNP; snp++)
+		{
+			optimalPartitions.addSNP(snp, run.actives);
+		}
+		oldActives = run.actives;
+		oldRowPartitions = SparsePartition::getAllPartitions(oldActives, oldRowMemoryAllocator, pool);
+		profile.times[ColumnProfile::Enumerate] += timer.lap();
+		profile.partitions = oldRowPartitions.size();
+		oldRowCosts.resize(oldRowPartitions.size());
+		pool.forChunks(oldRowPartitions.size(), 1024, [&oldRowCosts, &oldRowPartitions, &run, baseCost](size_t start, size_t end)
+		{
+			ColumnCostEvaluator<Layout> evaluator { run, k };
+			for (size_t i = start; i < end; i++)
+			{
+				oldRowCosts[i] = baseCost+evaluator.deltaCost(oldRowPartitions[i]);
+			}
+		});
+		profile.times[ColumnProfile::Cost] += timer.lap();
+		if (bounds.enabled())
+		{
+			std::vector<size_t> kept = bounds.keptIndices(oldRowCosts, run.lastSNP);
+			numPruned += oldRowCosts.size()-kept.size();
+			keepIndices(oldRowPartitions, kept);
+			keepIndices(oldRowCosts, kept);
+		}
+		if (history != nullptr)
+		{
+			history->add(oldActives, oldRowPartitions, oldRowCosts, std::vector<size_t> {});
+		}
+		profile.times[ColumnProfile::Prune] += timer.lap();
+		optimalPartitions.startSNP(run.firstSNP, oldRowPartitions.size());
+		for (size_t i = 0; i < oldRowPartitions.size(); i++)
+		{
+			oldOptimalPartitions.push_back(optimalPartitions.insertPartition(oldRowPartitions[i], run.firstSNP, oldActives.size(), i));
+		}
+		profile.times[ColumnProfile::Extend] += timer.lap();
+		if (beam.width > 0)
+		{
+			double cheapestDropped = std::numeric_limits<double>::infinity();
+			std::vector<size_t> kept = pruneToBeam(oldRowPartitions, oldRowCosts, oldOptimalPartitions, oldRowMemoryAllocator, oldActives.size(), beam, cheapestDropped);
+			beamBound.dropped(cheapestDropped, run.lastSNP, bounds);
+			if (history != nullptr)
+			{
+				history->keep(kept);
+			}
+		}
+		profile.times[ColumnProfile::Prune] += timer.lap();
+		optimalPartitions.setCurrentPartitions(oldOptimalPartitions);
+		profile.times[ColumnProfile::GC] += timer.lap();
+		profile.kept = oldRowPartitions.size();
+		profile.arenaBytes = oldRowMemoryAllocator.usedBytes();
+		profile.tracebackBytes = optimalPartitions.bytesUsed();
+		columnTrace.write(profile);
+		blockFirstRow = numAll;
+		numAll += oldActives.size();
+	};
+
+	auto lastColumnTime = std::chrono::steady_clock::now();
+	std::unique_ptr<CheckpointWriter> checkpointWriter;
+	if (checkpoint.path.size() > 0)
+	{
+		checkpointWriter.reset(new CheckpointWriter { checkpoint.path });
+	}
+	auto lastCheckpointTime = std::chrono::steady_clock::now();
+	size_t lastCheckpointSNP = lastSNP;
+	bool firstRun = !resumed;
+
+	while (runs.next())
+	{
+		ColumnRun& run = runs.run();
+		ColumnProfile profile { run.firstSNP, run.lastSNP, run.actives.size(), 0 };
+		LapTimer timer;
+		//the state between the columns up to lastSNP and this run. a checkpoint still being written is not waited for, this one is skipped instead
+		if (checkpointWriter != nullptr && checkpointWriter->ready() && oldActives.size() > 0 && history == nullptr)
+		{
+			std::chrono::duration<double> sinceCheckpoint = std::chrono::steady_clock::now()-lastCheckpointTime;
+			if ((checkpoint.everyColumns > 0 && lastSNP >= lastCheckpointSNP+checkpoint.everyColumns) || (checkpoint.everySeconds > 0 && sinceCheckpoint.count() >= checkpoint.everySeconds))
+			{
+				checkpointWriter->writeAsync(frontierCheckpoint<Layout>(header, lastSNP, columnsHash, numAll, numPruned, beamBound, finishedAssignments, numFinishedBlocks, blockFirstRow, oldActives, oldRowPartitions, oldRowCosts, oldOptimalPartitions, optimalPartitions));
+				lastCheckpointTime = std::chrono::steady_clock::now();
+				lastCheckpointSNP = lastSNP;
+			}
+		}
+		profile.times[ColumnProfile::Checkpoint] += timer.lap();
+		lastSNP = run.lastSNP;
+		columnsHash = hashColumns(columnsHash, run);
+		size_t snp = run.firstSNP;
+		ActiveRowSet& actives = run.actives;
+		auto newColumnTime = std::chrono::steady_clock::now();
+		auto diff = std::chrono::duration_cast<std::chrono::duration<int,std::milli>>(newColumnTime-lastColumnTime);
+		ActiveRowSet intersect = setIntersection(actives, oldActives);
+		actives.buildRankIndex();
+		profile.intersection = intersect.size();
+		lastColumnTime = newColumnTime;
+		if (!firstRun)
+		{
+			columnLog << " " << diff.count() << "ms\n";
+		}
+		firstRun = false;
+		columnLog << "column " << snp << " (" << actives.size() << ", " << intersect.size() << ")";
+		if (run.lastSNP > snp)
+		{
+			columnLog << " to " << run.lastSNP;
+		}
+		profile.times[ColumnProfile::Split] += timer.lap();
+		//a column without rows changes nothing, and the next column with rows can't share any with the old ones
+		if (actives.size() == 0)
+		{
+			columnTrace.write(profile);
+			continue;
+		}
+		if (intersect.size() == 0)
+		{
+			startBlock(run, profile, timer);
+			continue;
+		}
+		for (size_t i = run.firstSNP; i <= run.lastSNP; i++)
+		{
+			optimalPartitions.addSNP(i, actives);
+		}
+		//only when a run was longer than the maximum run length
+		if (actives == oldActives)
+		{
+			profile.partitions = oldRowCosts.size();
+			pool.forChunks(oldRowCosts.size(), 1024, [&oldRowCosts, &oldRowPartitions, &run](size_t start, size_t end)
+			{
+				ColumnCostEvaluator<Layout> evaluator { run, k };
+				for (size_t i = start; i < end; i++)
+				{
+					oldRowCosts[i] += evaluator.deltaCost(oldRowPartitions[i]);
+				}
+			});
+			profile.times[ColumnProfile::Cost] += timer.lap();
+			if (bounds.enabled())
+			{
+				std::vector<size_t> kept = bounds.keptIndices(oldRowCosts, run.lastSNP);
+				numPruned += oldRowCosts.size()-kept.size();
+				keepIndices(oldRowPartitions, kept);
+				keepIndices(oldRowCosts, kept);
+				keepIndices(oldOptimalPartitions, kept);
+				if (history != nullptr)
+				{
+					history->keep(kept);
+				}
+				profile.times[ColumnProfile::Prune] += timer.lap();
+				optimalPartitions.setCurrentPartitions(oldOptimalPartitions);
+				profile.times[ColumnProfile::GC] += timer.lap();
+			}
+			if (history != nullptr)
+			{
+				history->setCosts(oldRowCosts);
+			}
+			profile.kept = oldRowCosts.size();
+			profile.arenaBytes = oldRowMemoryAllocator.usedBytes();
+			profile.tracebackBytes = optimalPartitions.bytesUsed();
+			columnTrace.write(profile);
+			continue;
+		}
+		auto joinStart = std::chrono::steady_clock::now();
+		//the beam or the pruning only leave some of the classes, so only their extensions are enumerated
+		bool partialJoin = beam.width > 0 || bounds.enabled();
+		newRowMemoryAllocator.reset();
+		std::vector<SparsePartition> newRowPartitions;
+		std::vector<size_t> optimalExtensions;
+		profile.times[ColumnProfile::GC] += timer.lap();
+		if (join == ExtensionJoin::Enumerate)
+		{
+			{
+				ProjectionClassTable<Layout> classes { oldRowPartitions, oldActives, intersect, oldRowCosts, pool };
+				std::vector<size_t> classOffsets;
+				if (partialJoin)
+				{
+					classOffsets = extensionOffsets(classes, actives, intersect);
+				}
+				profile.times[ColumnProfile::Split] += timer.lap();
+				std::vector<size_t> positions;
+				enumerateExtensions(classes, actives, intersect, classOffsets, newRowPartitions, optimalExtensions, positions, newRowMemoryAllocator, pool);
+				profile.times[ColumnProfile::Enumerate] += timer.lap();
+				if (partialJoin)
+				{
+					sortByPosition(positions, newRowPartitions, optimalExtensions, pool);
+					profile.times[ColumnProfile::Sort] += timer.lap();
+				}
+			}
+			clearVector(oldRowPartitions);
+			oldRowMemoryAllocator.reset();
+			profile.times[ColumnProfile::GC] += timer.lap();
+		}
+		else
+		{
+			newRowPartitions = SparsePartition::getAllPartitions(actives, newRowMemoryAllocator, pool);
+			profile.times[ColumnProfile::Enumerate] += timer.lap();
+		}
+		profile.partitions = newRowPartitions.size();
+		columnLog << " (" << newRowPartitions.size() << " partitions)";
+		if (join == ExtensionJoin::Hash)
+		{
+			optimalExtensions = findExtensionsByHash<Layout>(oldRowPartitions, oldActives, newRowPartitions, actives, intersect, oldRowCosts, pool);
+			profile.times[ColumnProfile::Join] += timer.lap();
+			clearVector(oldRowPartitions);
+			oldRowMemoryAllocator.reset();
+			profile.times[ColumnProfile::GC] += timer.lap();
+		}
+		else if (join == ExtensionJoin::SortMerge)
+		{
+			TinyVectorMemoryAllocator tempOldRowMemoryAllocator;
+			auto tempOldRowPartitions = splitIntersection<Layout>(oldRowPartitions, intersect, oldActives, tempOldRowMemoryAllocator, pool);
+			profile.times[ColumnProfile::Split] += timer.lap();
+			clearVector(oldRowPartitions);
+			oldRowMemoryAllocator.reset();
+			profile.times[ColumnProfile::GC] += timer.lap();
+			TinyVectorMemoryAllocator tempNewRowMemoryAllocator;
+			auto tempNewRowPartitions = splitIntersection<Layout>(newRowPartitions, intersect, actives, tempNewRowMemoryAllocator, pool);
+			profile.times[ColumnProfile::Split] += timer.lap();
+			optimalExtensions = findExtensions<Layout>(tempOldRowPartitions, tempNewRowPartitions, intersect.size(), oldRowCosts, pool);
+			profile.times[ColumnProfile::Join] += timer.lap();
+//			auto extensions = findExtensions(tempOldRowPartitions, tempNewRowPartitions, intersect.size());
+//			auto optimalExtensions2 = findOptimalExtensions(extensions, oldRowCosts);
+//			assert(std::equal(optimalExtensions.begin(), optimalExtensions.end(), optimalExtensions2.begin()));
+		}
+		joinTime += std::chrono::steady_clock::now()-joinStart;
+		std::vector<double> newRowCosts;
+		std::vector<size_t> newOptimalPartitions;
+		newRowCosts.resize(newRowPartitions.size());
+		size_t numNews = actives.size()-intersect.size();
+		pool.forChunks(optimalExtensions.size(), 256, [&](size_t start, size_t end)
+		{
+			ColumnCostEvaluator<Layout> evaluator { run, k };
+			for (size_t j = start; j < end; j++)
+			{
+				assert(optimalExtensions[j] < oldRowCosts.size());
+				newRowCosts[j] = oldRowCosts[optimalExtensions[j]]+evaluator.deltaCost(newRowPartitions[j]);
+			}
+		});
+		profile.times[ColumnProfile::Cost] += timer.lap();
+		//pruned before they are stored in the traceback
+		if (bounds.enabled())
+		{
+			std::vector<size_t> kept = bounds.keptIndices(newRowCosts, run.lastSNP);
+			numPruned += newRowCosts.size()-kept.size();
+			keepIndices(newRowPartitions, kept);
+			keepIndices(newRowCosts, kept);
+			keepIndices(optimalExtensions, kept);
+			columnLog << " (" << newRowPartitions.size() << " kept)";
+			profile.times[ColumnProfile::Prune] += timer.lap();
+		}
+		if (history != nullptr)
+		{
+			history->add(actives, newRowPartitions, newRowCosts, optimalExtensions);
+		}
+		newOptimalPartitions.resize(newRowPartitions.size());
+		optimalPartitions.startSNP(snp, optimalExtensions.size());
+		pool.forChunks(optimalExtensions.size(), 256, [&](size_t start, size_t end)
+		{
+			for (size_t j = start; j < end; j++)
+			{
+				assert(optimalExtensions[j] < oldOptimalPartitions.size());
+				newOptimalPartitions[j] = optimalPartitions.extendPartition(oldOptimalPartitions[optimalExtensions[j]], newRowPartitions[j], snp, maxSNP, numAll-blockFirstRow, actives, intersect, j);
+			}
+		});
+		clearVector(optimalExtensions);
+		profile.times[ColumnProfile::Extend] += timer.lap();
+		if (beam.width > 0)
+		{
+			double cheapestDropped = std::numeric_limits<double>::infinity();
+			std::vector<size_t> kept = pruneToBeam(newRowPartitions, newRowCosts, newOptimalPartitions, newRowMemoryAllocator, actives.size(), beam, cheapestDropped);
+			beamBound.dropped(cheapestDropped, run.lastSNP, bounds);
+			if (history != nullptr)
+			{
+				history->keep(kept);
+			}
+			columnLog << " (" << newRowPartitions.size() << " kept)";
+			profile.times[ColumnProfile::Prune] += timer.lap();
+		}
+		optimalPartitions.setCurrentPartitions(newOptimalPartitions);
+		profile.times[ColumnProfile::GC] += timer.lap();
+		profile.kept = newRowPartitions.size();
+		profile.arenaBytes = oldRowMemoryAllocator.usedBytes()+newRowMemoryAllocator.usedBytes();
+		profile.tracebackBytes = optimalPartitions.bytesUsed();
+		columnTrace.write(profile);
+		oldRowPartitions = std::move(newRowPartitions);
+		oldRowCosts = std::move(newRowCosts);
+		oldOptimalPartitions = std::move(newOptimalPartitions);
+		std::swap(oldRowMemoryAllocator, newRowMemoryAllocator);
+		oldActives = std::move(actives);
+		numAll += numNews;
+	}
+
+	HaplotypeAlternatives result;
+	std::vector<std::tuple<std::vector<size_t>, double>>& solutions = result.solutions;
+	//no column has rows
+	if (oldRowCosts.size() == 0)
+	{
+		solutions.emplace_back(finishedAssignments, 0);
+	}
+	else
+	{
+		//ties broken by index like the blocks' optima
+		size_t best = 0;
+		for (size_t i = 1; i < oldRowCosts.size(); i++)
+		{
+			if (oldRowCosts[i] < oldRowCosts[best])
+			{
+				best = i;
+			}
+		}
+		std::vector<size_t> assignment = finishedAssignments;
+		optimalPartitions.getAssignments(oldOptimalPartitions[best], assignment);
+		//a file's reads without supports aren't counted in numAll, but the ones between the others are in the assignment in set 0
+		assert(assignment.size() >= numAll);
+		solutions.emplace_back(assignment, oldRowCosts[best]);
+	}
+	if (history != nullptr)
+	{
+		history->findAlternatives(std::get<0>(solutions[0]).size(), numSolutions, solutions, result.margins);
+	}
+	double score = std::get<1>(solutions[0]);
+	columnLog << "\n";
+	log << (join == ExtensionJoin::Hash ? "hash join" : (join == ExtensionJoin::SortMerge ? "sort-merge join" : "class enumeration")) << ": new partitions and extensions in " << (size_t)joinTime.count() << "ms";
+	if (numFinishedBlocks > 0)
+	{
+		log << "\n" << numFinishedBlocks+1 << " blocks between columns without shared rows, each restarted from the previous one's optimum";
+	}
+	if (bounds.enabled())
+	{
+		log << "\nbranch and bound from a solution of score " << bounds.upperBound << ": " << numPruned << " partitions pruned";
+	}
+	if (beam.width > 0)
+	{
+		double lowerBound = beamBound.bound(score, lastSNP, bounds);
+		log << "\nbeam of " << beam.width << ": optimal score is at least " << lowerBound << ", result is at most " << score-lowerBound << " above it";
+	}
+	log << "\ntraceback peak " << optimalPartitions.peakBytesUsed() << " bytes for " << optimalPartitions.peakAssignmentsStored() << " assignments (" << (double)optimalPartitions.peakBytesUsed()/(double)std::max(optimalPartitions.peakAssignmentsStored(), (size_t)1) << " bytes per assignment)";
+	log << "\npartition arenas peak " << oldRowMemoryAllocator.peakBytes()+newRowMemoryAllocator.peakBytes() << " bytes allocated, " << oldRowMemoryAllocator.reservedBytes()+newRowMemoryAllocator.reservedBytes() << " bytes in slabs\n";
+
+	if (checkpointWriter != nullptr)
+	{
+		checkpointWriter->writeNow(resultCheckpoint(header, lastSNP, columnsHash, result));
+	}
+	return result;
+}
+
+//picks the assignment layout specialized for log2k, other k use the runtime layout
+template <typename ColumnSource>
+HaplotypeAlternatives haplotypeWithLayout(ColumnSource& source, DPWorkspace& workspace, ExtensionJoin join, const BeamSettings& beam, const PruningBounds& bounds, size_t numSolutions, const CheckpointSettings& checkpoint, bool quiet, ColumnTrace& columnTrace, std::ostream& log)
+{
+	switch(log2k)
+	{
+		case 1:
+			return haplotypeColumns<AssignmentLayout<1>>(source, workspace, join, beam, bounds, numSolutions, checkpoint, quiet, columnTrace, log);
+		case 2:
+			return haplotypeColumns<AssignmentLayout<2>>(source, workspace, join, beam, bounds, numSolutions, checkpoint, quiet, columnTrace, log);
+		case 3:
+			return haplotypeColumns<AssignmentLayout<3>>(source, workspace, join, beam, bounds, numSolutions, checkpoint, quiet, columnTrace, log);
+		case 4:
+			return haplotypeColumns<AssignmentLayout<4>>(source, workspace, join, beam, bounds, numSolutions, checkpoint, quiet, columnTrace, log);
+		default:
+			return haplotypeColumns<RuntimeLayout>(source, workspace, join, beam, bounds, numSolutions, checkpoint, quiet, columnTrace, log);
+	}
+}
+
+//the upper bound for pruning is the score of a narrow beam over a separate source with the same columns
+//without pruning, a beam run only gets the lower bounds for its bound on the optimal score
+template <typename ColumnSource>
+PruningBounds findPruningBounds(ColumnSource& source, const ColumnLowerBounds& lowerBounds, DPWorkspace& workspace, ExtensionJoin join, bool prune, bool quiet, std::ostream& log)
+{
+	PruningBounds bounds { std::numeric_limits<double>::infinity(), lowerBounds.remaining(source.numSNPs()) };
+	if (!prune)
+	{
+		return bounds;
+	}
+	log << "upper bound from a beam of " << pruningBeamWidth << "\n";
+	ColumnTrace noTrace;
+	bounds.upperBound = std::get<1>(haplotypeWithLayout(source, workspace, join, BeamSettings { pruningBeamWidth, 0, 0 }, bounds, 1, CheckpointSettings {}, quiet, noTrace, log).solutions[0]);
+	return bounds;
+}
+
+//the DP for in-memory supports whose rows are numbered in the order they start, with pruning bounds from a beam run if asked for
+HaplotypeAlternatives haplotypeSupports(const SupportMatrix& supports, DPWorkspace& workspace, const HaplotyperOptions& options, size_t numSolutions, ColumnTrace& trace, std::ostream& log)
+{
+	PruningBounds bounds;
+	if (options.prune || options.beam.width > 0)
+	{
+		ColumnLowerBounds lowerBounds { k };
+		for (const auto& x : supports)
+		{
+			lowerBounds.add(x);
+		}
+		SupportMatrixColumnSource beamSource { supports };
+		bounds = findPruningBounds(beamSource, lowerBounds, workspace, options.join, options.beam.width == 0, options.trace.quiet, log);
+	}
+	SupportMatrixColumnSource source { supports };
+	return haplotypeWithLayout(source, workspace, options.join, options.beam, bounds, numSolutions, options.checkpoint, options.trace.quiet, trace, log);
+}
+
+//consecutive SNPs and the rows supported in them, renumbered from 0 so they can be haplotyped on their own
+class IndependentBlock
+{
+public:
+	size_t firstSNP;
+	size_t lastSNP;
+	//the block's row i is rows[i]. increasing, so the rows are still numbered in the order they start
+	std::vector<size_t> rows;
+	SupportMatrix supports;
+};
+
+//block's supports are the matrix's supports of its SNPs, renumbered
+void fillBlock(IndependentBlock& block, const SupportMatrix& supports)
+{
+	size_t start = supports.SNPstart(block.firstSNP);
+	size_t end = supports.SNPstart(block.lastSNP+1);
+	for (size_t i = start; i < end; i++)
+	{
+		block.rows.push_back(supports.read(i));
+	}
+	std::sort(block.rows.begin(), block.rows.end());
+	block.rows.erase(std::unique(block.rows.begin(), block.rows.end()), block.rows.end());
+	block.supports.reserve(end-start);
+	for (size_t i = start; i < end; i++)
+	{
+		SNPSupport x = supports[i];
+		x.SNPnum -= block.firstSNP;
+		x.readNum = std::lower_bound(block.rows.begin(), block.rows.end(), x.readNum)-block.rows.begin();
+		block.supports.add(x);
+	}
+	block.supports.index();
+}
+
+//cuts between the SNPs which at most maxBridgingRows rows span. with 0 the blocks are independent and their optimal solutions together are optimal
+//otherwise a row spanning a cut is split into a row in each block it has supports in
+std::vector<IndependentBlock> splitIndependentBlocks(const SupportMatrix& supports, size_t maxBridgingRows)
+{
+	size_t numSNPs = supports.numSNPs();
+	std::vector<size_t> starts = findBlockStarts(getRowExtents(supports), numSNPs, maxBridgingRows);
+	std::vector<IndependentBlock> blocks;
+	blocks.resize(starts.size());
+	for (size_t i = 0; i < starts.size(); i++)
+	{
+		blocks[i].firstSNP = starts[i];
+		blocks[i].lastSNP = i+1 < starts.size() ? starts[i+1]-1 : numSNPs-1;
+	}
+	std::vector<IndependentBlock> ret;
+	for (auto& block : blocks)
+	{
+		if (supports.SNPstart(block.firstSNP) == supports.SNPstart(block.lastSNP+1))
+		{
+			continue;
+		}
+		fillBlock(block, supports);
+		ret.push_back(std::move(block));
+	}
+	return ret;
+}
+
+//relabels right's sets to agree with left on as many rows as possible, greedily by the number of agreeing rows
+//sets without agreeing rows keep their number if it's free, so with no overlap the numbering is the identity like getNumbering's
+std::vector<size_t> getAgreeingNumbering(const std::vector<size_t>& left, const std::vector<size_t>& right, size_t k)
+{
+	assert(left.size() == right.size());
+	std::vector<std::tuple<size_t, size_t, size_t>> agreements;
+	std::vector<size_t> counts;
+	counts.resize(k*k, 0);
+	for (size_t i = 0; i < left.size(); i++)
+	{
+		assert(left[i] < k);
+		assert(right[i] < k);
+		counts[right[i]*k+left[i]]++;
+	}
+	for (size_t i = 0; i < k*k; i++)
+	{
+		if (counts[i] > 0)
+		{
+			agreements.emplace_back(counts[i], i / k, i % k);
+		}
+	}
+	std::sort(agreements.begin(), agreements.end(), [](std::tuple<size_t, size_t, size_t> left, std::tuple<size_t, size_t, size_t> right) { return std::get<0>(left) > std::get<0>(right) || (std::get<0>(left) == std::get<0>(right) && std::make_pair(std::get<1>(left), std::get<2>(left)) < std::make_pair(std::get<1>(right), std::get<2>(right))); });
+	std::vector<size_t> numbering;
+	numbering.resize(k, -1);
+	std::vector<bool> used;
+	used.resize(k, false);
+	for (auto x : agreements)
+	{
+		if (numbering[std::get<1>(x)] == -1 && !used[std::get<2>(x)])
+		{
+			numbering[std::get<1>(x)] = std::get<2>(x);
+			used[std::get<2>(x)] = true;
+		}
+	}
+	for (size_t i = 0; i < k; i++)
+	{
+		if (numbering[i] == -1 && !used[i])
+		{
+			numbering[i] = i;
+			used[i] = true;
+		}
+	}
+	for (size_t i = 0, next = 0; i < k; i++)
+	{
+		if (numbering[i] == -1)
+		{
+			while (used[next])
+			{
+				next++;
+			}
+			numbering[i] = next;
+			used[next] = true;
+		}
+	}
+	return numbering;
+}
+
+//the same cost as the DP for an assignment of every row
+double assignmentCost(const SupportMatrix& supports, const std::vector<size_t>& assignment)
+{
+	size_t numSNPs = supports.numSNPs();
+	std::vector<std::array<double, 4>> costs;
+	costs.resize(numSNPs*k, {0, 0, 0, 0});
+	for (const auto& x : supports)
+	{
+		assert(x.readNum < assignment.size());
+		std::array<double, 4>& setCosts = costs[x.SNPnum*k+assignment[x.readNum]];
+		switch(x.variant)
+		{
+			case 'A':
+				setCosts[0] += x.support;
+				break;
+			case 'T':
+				setCosts[1] += x.support;
+				break;
+			case 'C':
+				setCosts[2] += x.support;
+				break;
+			case 'G':
+				setCosts[3] += x.support;
+				break;
+			default:
+				break;
+		}
+	}
+	double result = 0;
+	for (size_t i = 0; i < numSNPs; i++)
+	{
+		size_t totalCost = 0;
+		for (size_t j = i*k; j < (i+1)*k; j++)
+		{
+			totalCost += costs[j][0]+costs[j][1]+costs[j][2]+costs[j][3]-std::max(std::max(costs[j][0], costs[j][1]), std::max(costs[j][2], costs[j][3]));
+		}
+		result += totalCost;
+	}
+	return result;
+}
+
+//the numSolutions cheapest haplotypings found, cheapest first. the supports are cut into independent blocks which are haplotyped concurrently and stitched together
+//the alternatives combine the blocks' own alternatives, cheapest first. a row's margin is the one in its block
+HaplotypeAlternatives haplotypeBlocks(const SupportMatrix& supports, size_t numSolutions, DPWorkspace& workspace, const HaplotyperOptions& options, ColumnTrace& trace, std::ostream& log)
+{
+	std::vector<IndependentBlock> blocks = splitIndependentBlocks(supports, options.maxBridgingRows);
+	if (blocks.size() <= 1)
+	{
+		return haplotypeSupports(supports, workspace, options, numSolutions, trace, log);
+	}
+	log << blocks.size() << " blocks\n";
+	//largest blocks first so a large block doesn't start last
+	std::vector<size_t> order;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&blocks](size_t left, size_t right) { return blocks[left].supports.size() > blocks[right].supports.size() || (blocks[left].supports.size() == blocks[right].supports.size() && left < right); });
+	std::vector<HaplotypeAlternatives> blockResults;
+	blockResults.resize(blocks.size());
+	std::vector<std::ostringstream> blockLogs;
+	blockLogs.resize(blocks.size());
+	std::vector<std::ostringstream> blockTraces;
+	blockTraces.resize(blocks.size());
+	//each running block has its own workspace from workspace's jobs, the blocks are spread over the threads of workspace's pool
+	size_t threadsPerBlock = std::max(workspace.pool.size() / blocks.size(), (size_t)1);
+	workspace.pool.run(blocks.size(), [&](size_t job)
+	{
+		size_t b = order[job];
+		std::unique_ptr<DPWorkspace> blockWorkspace = workspace.jobs.take(threadsPerBlock);
+		HaplotyperOptions blockOptions = options;
+		if (options.checkpoint.path.size() > 0)
+		{
+			blockOptions.checkpoint.path = options.checkpoint.path + ".block" + std::to_string(b);
+		}
+		ColumnTrace blockTrace = trace.part(blockTraces[b], blocks[b].firstSNP);
+		blockResults[b] = haplotypeSupports(blocks[b].supports, *blockWorkspace, blockOptions, numSolutions, blockTrace, blockLogs[b]);
+		workspace.jobs.give(std::move(blockWorkspace));
+	});
+
+	size_t numRows = 0;
+	for (const auto& x : supports)
+	{
+		numRows = std::max(numRows, x.readNum+1);
+	}
+	double blockScoreSum = 0;
+	//rows spanning a cut, split into a row in each block
+	size_t numBridged = 0;
+	std::vector<bool> seen;
+	seen.resize(numRows, false);
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		log << "block " << b << ": SNPs " << blocks[b].firstSNP << " to " << blocks[b].lastSNP << ", " << blocks[b].rows.size() << " rows\n" << blockLogs[b].str();
+		trace.append(blockTraces[b].str());
+		blockScoreSum += std::get<1>(blockResults[b].solutions[0]);
+		for (auto row : blocks[b].rows)
+		{
+			if (seen[row])
+			{
+				numBridged++;
+			}
+			seen[row] = true;
+		}
+	}
+	bool bridged = numBridged > 0;
+	//the blocks' solutions picked by choice, relabeled to agree on the rows spanning the cuts
+	auto stitch = [&](const std::vector<size_t>& choice)
+	{
+		std::vector<size_t> result;
+		result.resize(numRows, 0);
+		std::vector<bool> assigned;
+		assigned.resize(numRows, false);
+		double score = 0;
+		for (size_t b = 0; b < blocks.size(); b++)
+		{
+			const std::vector<size_t>& blockResult = std::get<0>(blockResults[b].solutions[choice[b]]);
+			assert(blockResult.size() == blocks[b].rows.size());
+			score += std::get<1>(blockResults[b].solutions[choice[b]]);
+			std::vector<size_t> left;
+			std::vector<size_t> right;
+			for (size_t i = 0; i < blockResult.size(); i++)
+			{
+				if (assigned[blocks[b].rows[i]])
+				{
+					left.push_back(result[blocks[b].rows[i]]);
+					right.push_back(blockResult[i]);
+				}
+			}
+			std::vector<size_t> numbering = getAgreeingNumbering(left, right, k);
+			for (size_t i = 0; i < blockResult.size(); i++)
+			{
+				if (!assigned[blocks[b].rows[i]])
+				{
+					result[blocks[b].rows[i]] = numbering[blockResult[i]];
+					assigned[blocks[b].rows[i]] = true;
+				}
+			}
+		}
+		if (bridged)
+		{
+			score = assignmentCost(supports, result);
+		}
+		return std::tuple<std::vector<size_t>, double> { result, score };
+	};
+	HaplotypeAlternatives result;
+	std::vector<std::tuple<std::vector<size_t>, double>>& solutions = result.solutions;
+	solutions.push_back(stitch(std::vector<size_t>(blocks.size(), 0)));
+	if (bridged)
+	{
+		//the blocks' scores are for the rows split at the cuts, so their sum is a lower bound if the blocks are optimal
+		double lowerBound = std::min(blockScoreSum, std::get<1>(solutions[0]));
+		log << "bridge of " << options.maxBridgingRows << ": " << numBridged << " rows split at the cuts, the result is approximate. optimal score is at least " << lowerBound << ", result is at most " << std::get<1>(solutions[0])-lowerBound << " above it\n";
+	}
+	//best first over which of its solutions each block uses, by the extra cost over the blocks' optima. a choice is reached from the one with
+	//the solution of its last changed block one cheaper, and only changes that block or later ones, so every choice is reached once
+	typedef std::tuple<double, std::vector<size_t>, size_t> Choice;
+	std::priority_queue<Choice, std::vector<Choice>, std::greater<Choice>> choices;
+	auto change = [&](const Choice& from, size_t b)
+	{
+		std::vector<size_t> choice = std::get<1>(from);
+		if (choice[b]+1 >= blockResults[b].solutions.size())
+		{
+			return;
+		}
+		choice[b]++;
+		double extra = std::get<0>(from)+std::get<1>(blockResults[b].solutions[choice[b]])-std::get<1>(blockResults[b].solutions[choice[b]-1]);
+		choices.emplace(extra, std::move(choice), b);
+	};
+	Choice optimal { 0, std::vector<size_t>(blocks.size(), 0), 0 };
+	for (size_t b = 0; b < blocks.size() && numSolutions > 1; b++)
+	{
+		change(optimal, b);
+	}
+	while (choices.size() > 0 && solutions.size() < numSolutions)
+	{
+		Choice top = choices.top();
+		choices.pop();
+		solutions.push_back(stitch(std::get<1>(top)));
+		for (size_t b = std::get<2>(top); b < blocks.size(); b++)
+		{
+			change(top, b);
+		}
+	}
+	std::stable_sort(solutions.begin()+1, solutions.end(), [](const std::tuple<std::vector<size_t>, double>& left, const std::tuple<std::vector<size_t>, double>& right) { return std::get<1>(left) < std::get<1>(right); });
+	if (numSolutions > 1)
+	{
+		result.margins.resize(numRows, std::numeric_limits<double>::infinity());
+		for (size_t b = 0; b < blocks.size(); b++)
+		{
+			assert(blockResults[b].margins.size() == blocks[b].rows.size());
+			for (size_t i = 0; i < blocks[b].rows.size(); i++)
+			{
+				result.margins[blocks[b].rows[i]] = std::min(result.margins[blocks[b].rows[i]], blockResults[b].margins[i]);
+			}
+		}
+	}
+	return result;
+}
+
+Haplotyper::Haplotyper(size_t k, const HaplotyperOptions& options) :
+	k(k),
+	options(options),
+	workspace(new DPWorkspace { k, options.numThreads })
+{
+}
+
+Haplotyper::~Haplotyper()
+{
+}
+
+size_t Haplotyper::getk() const
+{
+	return k;
+}
 
+const HaplotyperOptions& Haplotyper::getOptions() const
+{
+	return options;
+}
+
+//returns optimal partition and its score
+std::tuple<std::vector<size_t>, double> Haplotyper::haplotype(const SupportMatrix& supports)
+{
+	RunParameters parameters { k };
+	TraceFile traceFile { options.trace.path };
+	ColumnTrace trace = traceFile.trace();
+	return haplotypeBlocks(supports, 1, *workspace, options, trace, std::cerr).solutions[0];
+}
+
+std::tuple<std::vector<size_t>, double> haplotype(const SupportMatrix& supports, size_t k, const HaplotyperOptions& options)
+{
+	Haplotyper haplotyper { k, options };
+	return haplotyper.haplotype(supports);
+}
+
+//windows of windowSize SNPs, each starting windowSize-overlap SNPs after the previous one. only their SNPs are set,
+//fillBlock copies a window's supports when it is haplotyped so that the overlapping copies aren't all in memory at once
+std::vector<IndependentBlock> splitWindows(const SupportMatrix& supports, size_t windowSize, size_t overlap)
+{
+	assert(overlap < windowSize);
+	size_t numSNPs = supports.numSNPs();
+	size_t step = windowSize-overlap;
+	std::vector<IndependentBlock> windows;
+	for (size_t start = 0; windows.size() == 0 || windows.back().lastSNP+1 < numSNPs; start += step)
+	{
+		windows.emplace_back();
+		windows.back().firstSNP = start;
+		windows.back().lastSNP = std::min(start+windowSize, numSNPs)-1;
+	}
+	return windows;
+}
+
+std::tuple<std::vector<size_t>, double> Haplotyper::haplotypeWindows(const SupportMatrix& supports, size_t windowSize, size_t overlap)
+{
+	RunParameters parameters { k };
+	std::vector<IndependentBlock> windows = splitWindows(supports, windowSize, overlap);
+	std::cerr << windows.size() << " windows of " << windowSize << " SNPs overlapping by " << overlap << "\n";
+	std::vector<std::vector<size_t>> windowResults;
+	windowResults.resize(windows.size());
+	std::vector<std::ostringstream> windowLogs;
+	windowLogs.resize(windows.size());
+	TraceFile traceFile { options.trace.path };
+	ColumnTrace trace = traceFile.trace();
+	std::vector<std::ostringstream> windowTraces;
+	windowTraces.resize(windows.size());
+	size_t threadsPerWindow = std::max(workspace->pool.size() / windows.size(), (size_t)1);
+	workspace->pool.run(windows.size(), [&](size_t w)
+	{
+		fillBlock(windows[w], supports);
+		if (windows[w].supports.size() == 0)
+		{
+			return;
+		}
+		std::unique_ptr<DPWorkspace> windowWorkspace = workspace->jobs.take(threadsPerWindow);
+		//a window is only cut into independent blocks, not at bridged rows
+		HaplotyperOptions windowOptions = options;
+		windowOptions.maxBridgingRows = 0;
+		if (options.checkpoint.path.size() > 0)
+		{
+			windowOptions.checkpoint.path = options.checkpoint.path + ".window" + std::to_string(w);
+		}
+		ColumnTrace windowTrace = trace.part(windowTraces[w], windows[w].firstSNP);
+		windowResults[w] = std::get<0>(haplotypeBlocks(windows[w].supports, 1, *windowWorkspace, windowOptions, windowTrace, windowLogs[w]).solutions[0]);
+		workspace->jobs.give(std::move(windowWorkspace));
+		//only the rows are needed for stitching
+		windows[w].supports = SupportMatrix {};
+	});
+
+	//each row takes its set from the window whose part closer to it than to the neighbouring windows holds the middle of the row
+	std::vector<std::pair<size_t, size_t>> rowExtents = getRowExtents(supports);
+	size_t numRows = rowExtents.size();
+	std::vector<size_t> owner;
+	owner.resize(numRows, -1);
+	for (size_t w = 0; w < windows.size(); w++)
+	{
+		size_t coreStart = w == 0 ? 0 : windows[w].firstSNP+overlap/2;
+		size_t coreEnd = w+1 == windows.size() ? windows[w].lastSNP+1 : windows[w+1].firstSNP+overlap/2;
+		for (auto row : windows[w].rows)
+		{
+			size_t middle = (rowExtents[row].first+rowExtents[row].second)/2;
+			if (owner[row] == -1 || (middle >= coreStart && middle < coreEnd))
+			{
+				owner[row] = w;
+			}
+		}
+	}
+	//each window is relabeled to agree with the latest set of its rows in the windows before it
 	std::vector<size_t> result;
-	for (auto iter = partition.assignments.begin(); iter != partition.assignments.end(maxRead); iter++)
+	result.resize(numRows, 0);
+	std::vector<size_t> latest;
+	latest.resize(numRows, -1);
+	for (size_t w = 0; w < windows.size(); w++)
 	{
-		result.push_back((size_t)*iter);
+		std::cerr << "window " << w << ": SNPs " << windows[w].firstSNP << " to " << windows[w].lastSNP << ", " << windows[w].rows.size() << " rows\n" << windowLogs[w].str();
+		trace.append(windowTraces[w].str());
+		const std::vector<size_t>& windowResult = windowResults[w];
+		assert(windowResult.size() == windows[w].rows.size());
+		std::vector<size_t> left;
+		std::vector<size_t> right;
+		for (size_t i = 0; i < windowResult.size(); i++)
+		{
+			if (latest[windows[w].rows[i]] != -1)
+			{
+				left.push_back(latest[windows[w].rows[i]]);
+				right.push_back(windowResult[i]);
+			}
+		}
+		std::vector<size_t> numbering = getAgreeingNumbering(left, right, k);
+		size_t agreeing = 0;
+		for (size_t i = 0; i < left.size(); i++)
+		{
+			if (numbering[right[i]] == left[i])
+			{
+				agreeing++;
+			}
+		}
+		if (w > 0)
+		{
+			std::cerr << "window " << w << " agrees with the windows before it on " << agreeing << " of " << left.size() << " rows\n";
+		}
+		for (size_t i = 0; i < windowResult.size(); i++)
+		{
+			size_t row = windows[w].rows[i];
+			latest[row] = numbering[windowResult[i]];
+			if (owner[row] == w)
+			{
+				result[row] = latest[row];
+			}
+		}
 	}
+	double score = assignmentCost(supports, result);
 	return std::tuple<std::vector<size_t>, double> { result, score };
 }
+
+std::tuple<std::vector<size_t>, double> haplotypeWindows(const SupportMatrix& supports, size_t k, size_t windowSize, size_t overlap, const HaplotyperOptions& options)
+{
+	Haplotyper haplotyper { k, options };
+	return haplotyper.haplotypeWindows(supports, windowSize, overlap);
+}
+
+HaplotypeAlternatives Haplotyper::haplotypeAlternatives(const SupportMatrix& supports, size_t numSolutions)
+{
+	RunParameters parameters { k };
+	TraceFile traceFile { options.trace.path };
+	ColumnTrace trace = traceFile.trace();
+	//the DP only records the columns the margins come from when it looks for alternatives
+	HaplotypeAlternatives ret = haplotypeBlocks(supports, std::max(numSolutions, (size_t)2), *workspace, options, trace, std::cerr);
+	ret.solutions.resize(std::min(ret.solutions.size(), std::max(numSolutions, (size_t)1)));
+	return ret;
+}
+
+HaplotypeAlternatives haplotypeAlternatives(const SupportMatrix& supports, size_t k, size_t numSolutions, const HaplotyperOptions& options)
+{
+	Haplotyper haplotyper { k, options };
+	return haplotyper.haplotypeAlternatives(supports, numSolutions);
+}
+
+std::tuple<std::vector<size_t>, double> Haplotyper::haplotypeStreaming(std::string supportsFile)
+{
+	RunParameters parameters { k };
+	PruningBounds bounds;
+	if (options.prune || options.beam.width > 0)
+	{
+		ColumnLowerBounds lowerBounds { k };
+		SupportFileReader reader { supportsFile };
+		SNPSupport support { 0, 0, 'A', 0 };
+		while (reader.next(support))
+		{
+			lowerBounds.add(support);
+		}
+		SupportFileColumnSource beamSource { supportsFile };
+		bounds = findPruningBounds(beamSource, lowerBounds, *workspace, options.join, options.beam.width == 0, options.trace.quiet, std::cerr);
+	}
+	std::cerr << "row extents\n";
+	SupportFileColumnSource source { supportsFile };
+	TraceFile traceFile { options.trace.path };
+	ColumnTrace trace = traceFile.trace();
+	return haplotypeWithLayout(source, *workspace, options.join, options.beam, bounds, 1, options.checkpoint, options.trace.quiet, trace, std::cerr).solutions[0];
+}
+
+std::tuple<std::vector<size_t>, double> haplotypeStreaming(std::string supportsFile, size_t k, const HaplotyperOptions& options)
+{
+	Haplotyper haplotyper { k, options };
+	return haplotyper.haplotypeStreaming(supportsFile);
+}
+
+//sum over the added columns j of min(states[j], cap)*bytes[j], the most nodes of column j the traceback holds when cap partitions are alive
+//two fenwick trees over the distinct state counts, for the sums of the columns with fewer and more states than cap
+class TracebackBound
+{
+public:
+	TracebackBound(std::vector<size_t> stateValues) :
+		values(std::move(stateValues)),
+		weightedSums(),
+		byteSums(),
+		totalBytes(0)
+	{
+		std::sort(values.begin(), values.end());
+		values.erase(std::unique(values.begin(), values.end()), values.end());
+		weightedSums.resize(values.size()+1, 0);
+		byteSums.resize(values.size()+1, 0);
+	}
+	//states must be one of the constructor's values
+	void add(size_t states, size_t bytes)
+	{
+		assert(std::binary_search(values.begin(), values.end(), states));
+		for (size_t i = std::lower_bound(values.begin(), values.end(), states)-values.begin()+1; i < weightedSums.size(); i += i & -i)
+		{
+			weightedSums[i] = saturatingAdd(weightedSums[i], saturatingMultiply(states, bytes));
+			byteSums[i] = saturatingAdd(byteSums[i], bytes);
+		}
+		totalBytes = saturatingAdd(totalBytes, bytes);
+	}
+	size_t bound(size_t cap) const
+	{
+		size_t smallerWeighted = 0;
+		size_t smallerBytes = 0;
+		for (size_t i = std::upper_bound(values.begin(), values.end(), cap)-values.begin(); i > 0; i -= i & -i)
+		{
+			smallerWeighted = saturatingAdd(smallerWeighted, weightedSums[i]);
+			smallerBytes = saturatingAdd(smallerBytes, byteSums[i]);
+		}
+		return saturatingAdd(smallerWeighted, saturatingMultiply(cap, totalBytes-smallerBytes));
+	}
+private:
+	std::vector<size_t> values;
+	std::vector<size_t> weightedSums;
+	std::vector<size_t> byteSums;
+	size_t totalBytes;
+};
+
+//the DP's memory at one column where the active rows change
+class PlannedColumn
+{
+public:
+	size_t generated;
+	size_t kept;
+	size_t workingBytes;
+	size_t arenaBytes;
+	size_t nodeBytes;
+};
+
+MemoryPlanner::MemoryPlanner(const SupportMatrix& supports, size_t k, size_t numThreads) :
+	k(k),
+	concurrentBlocks(numThreads),
+	coverage(),
+	starting(),
+	ending()
+{
+	ActiveRowSweep sweep { supports, false };
+	record(sweep);
+}
+
+MemoryPlanner::MemoryPlanner(std::string supportsFile, size_t k) :
+	k(k),
+	concurrentBlocks(1),
+	coverage(),
+	starting(),
+	ending()
+{
+	ActiveRowSweep sweep = SupportFileColumnSource::sweepFile(supportsFile, false);
+	record(sweep);
+}
+
+void MemoryPlanner::record(ActiveRowSweep& sweep)
+{
+	coverage.reserve(sweep.numSNPs());
+	starting.reserve(sweep.numSNPs());
+	ending.reserve(sweep.numSNPs());
+	while (sweep.next())
+	{
+		coverage.push_back(sweep.coverage());
+		starting.push_back(sweep.startingEnd()-sweep.startingBegin());
+		ending.push_back(sweep.endingEnd()-sweep.endingBegin());
+	}
+}
+
+//predicted partitions and memory of the DP over the recorded SNPs
+//the blocks between columns with no overlap are independent, and the largest concurrentBlocks of them are assumed to run at once
+MemoryPlan MemoryPlanner::plan(BeamSettings beam) const
+{
+	size_t bits = std::max(ceil(log2(k)), 1.0);
+	auto bytesFor = [bits](size_t rows) { return (rows*bits+7)/8; };
+	size_t beamStates = beam.width > 0 ? beam.width+beam.marginLimit : std::numeric_limits<size_t>::max();
+	MemoryPlan plan;
+	plan.states.resize(coverage.size(), 0);
+	plan.largestColumn = 0;
+	plan.peakArenaBytes = 0;
+	plan.peakTracebackBytes = 0;
+	plan.peakBytes = 0;
+
+	std::vector<std::vector<PlannedColumn>> blocks;
+	size_t oldCoverage = 0;
+	size_t oldStates = 0;
+	size_t endingBefore = 0;
+	for (size_t SNP = 0; SNP < coverage.size(); SNP++)
+	{
+		size_t intersection = coverage[SNP]-starting[SNP];
+		if (coverage[SNP] == 0)
+		{
+			oldStates = 0;
+		}
+		else if (starting[SNP] > 0 || endingBefore > 0)
+		{
+			if (intersection == 0)
+			{
+				blocks.emplace_back();
+			}
+			PlannedColumn column;
+			column.generated = getNumberOfPartitions(coverage[SNP], k);
+			if (beam.width > 0 && intersection > 0)
+			{
+				size_t perClass = 1;
+				for (size_t i = 0; i < starting[SNP]; i++)
+				{
+					perClass = saturatingMultiply(perClass, k);
+				}
+				column.generated = std::min(column.generated, saturatingMultiply(oldStates, perClass));
+			}
+			column.kept = std::min(column.generated, beamStates);
+			//the old partitions and their projections, and the new partitions
+			column.arenaBytes = saturatingMultiply(oldStates, bytesFor(oldCoverage));
+			column.arenaBytes = saturatingAdd(column.arenaBytes, saturatingMultiply(oldStates, bytesFor(intersection)));
+			column.arenaBytes = saturatingAdd(column.arenaBytes, saturatingMultiply(column.generated, bytesFor(coverage[SNP])));
+			column.arenaBytes = saturatingAdd(column.arenaBytes, 3*TinyVectorMemoryAllocator::defaultSlabSize);
+			//partition handles, costs, traceback nodes, extensions and the projection table
+			column.workingBytes = saturatingMultiply(oldStates, sizeof(SparsePartition)+sizeof(SolidPartition)+6*sizeof(size_t));
+			column.workingBytes = saturatingAdd(column.workingBytes, saturatingMultiply(column.generated, sizeof(SparsePartition)+4*sizeof(size_t)));
+			column.workingBytes = saturatingAdd(column.workingBytes, column.arenaBytes);
+			//parent and reference count per node and the new rows' assignments
+			column.nodeBytes = starting[SNP] > 0 ? 2*sizeof(uint32_t)+bytesFor(starting[SNP]) : 0;
+			blocks.back().push_back(column);
+			plan.states[SNP] = column.generated;
+			if (column.generated > plan.states[plan.largestColumn])
+			{
+				plan.largestColumn = SNP;
+			}
+			plan.peakArenaBytes = std::max(plan.peakArenaBytes, column.arenaBytes);
+			oldStates = column.kept;
+		}
+		else
+		{
+			plan.states[SNP] = oldStates;
+		}
+		oldCoverage = coverage[SNP];
+		endingBefore = ending[SNP];
+	}
+
+	std::vector<size_t> blockPeaks;
+	for (const auto& block : blocks)
+	{
+		std::vector<size_t> stateValues;
+		for (const auto& column : block)
+		{
+			stateValues.push_back(column.generated);
+		}
+		TracebackBound traceback { stateValues };
+		size_t peak = 0;
+		size_t previousKept = 0;
+		for (const auto& column : block)
+		{
+			//the current column's nodes, and the older columns' live nodes. a column's nodes are compacted once at most half of them are alive
+			size_t tracebackBytes = saturatingAdd(saturatingMultiply(column.generated, column.nodeBytes), saturatingMultiply(2, traceback.bound(std::max(column.generated, previousKept))));
+			plan.peakTracebackBytes = std::max(plan.peakTracebackBytes, tracebackBytes);
+			peak = std::max(peak, saturatingAdd(column.workingBytes, tracebackBytes));
+			traceback.add(column.generated, column.nodeBytes);
+			previousKept = column.kept;
+		}
+		blockPeaks.push_back(peak);
+	}
+	std::sort(blockPeaks.begin(), blockPeaks.end(), std::greater<size_t>());
+	for (size_t i = 0; i < blockPeaks.size() && i < std::max(concurrentBlocks, (size_t)1); i++)
+	{
+		plan.peakBytes = saturatingAdd(plan.peakBytes, blockPeaks[i]);
+	}
+	return plan;
+}
+
+MemoryPlan planMemory(const SupportMatrix& supports, size_t k, size_t numThreads, BeamSettings beam)
+{
+	return MemoryPlanner { supports, k, numThreads }.plan(beam);
+}
+
+MemoryPlan planMemoryStreaming(std::string supportsFile, size_t k, BeamSettings beam)
+{
+	return MemoryPlanner { supportsFile, k }.plan(beam);
+}
@@ -6,9 +6,16 @@
 #include <vector>
 #include <set>
 #include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 
 #include "variant_utils.h"
+#include "thread_pool.h"
 
+//variants and costs are indexed by row-minRow
 class Column
 {
 public:
@@ -16,17 +23,19 @@ public:
 	Column(Iterator start, Iterator end, size_t column, size_t minRow, size_t maxRow) : variants(), minRow(minRow), maxRow(maxRow)
 	{
 		static_assert(std::is_constructible<SNPSupport, decltype(*start)>::value, "");
-		variants.resize(maxRow+1, 0);
-		costs.resize(maxRow+1, 0);
+		assert(maxRow >= minRow);
+		variants.resize(maxRow-minRow+1, 0);
+		costs.resize(maxRow-minRow+1, 0);
 		while (start != end)
 		{
 			SNPSupport s = *start;
 			if (s.SNPnum == column)
 			{
+				assert(s.readNum >= minRow);
 				assert(s.readNum <= maxRow);
 				assert(s.variant == 'A' || s.variant == 'T' || s.variant == 'C' || s.variant == 'G');
-				variants[s.readNum] = s.variant;
-				costs[s.readNum] = s.support;
+				variants[s.readNum-minRow] = s.variant;
+				costs[s.readNum-minRow] = s.support;
 			}
 			start++;
 		}
@@ -37,23 +46,79 @@ public:
 	size_t maxRow;
 };
 
+//sorted set of row numbers. rank queries are constant time after buildRankIndex, otherwise a binary search
+class ActiveRowSet
+{
+public:
+	ActiveRowSet();
+	//rows must be sorted and unique
+	ActiveRowSet(std::vector<uint32_t> rows);
+	static ActiveRowSet range(size_t start, size_t end);
+	size_t size() const;
+	bool contains(size_t row) const;
+	//index of row in the set, row must be in the set
+	size_t rank(size_t row) const;
+	uint32_t operator[](size_t index) const;
+	std::vector<uint32_t>::const_iterator begin() const;
+	std::vector<uint32_t>::const_iterator end() const;
+	bool operator==(const ActiveRowSet& second) const;
+	bool operator!=(const ActiveRowSet& second) const;
+	void buildRankIndex();
+	void clearRankIndex();
+private:
+	std::vector<uint32_t> rows;
+	//bit per row in [firstRow, rows.back()], and the number of rows before each word
+	std::vector<uint64_t> bits;
+	std::vector<uint32_t> wordRanks;
+	size_t firstRow;
+};
+
+ActiveRowSet setIntersection(const ActiveRowSet& left, const ActiveRowSet& right);
+//positions of subset's rows in set
+std::vector<size_t> subsetIndices(const ActiveRowSet& subset, const ActiveRowSet& set);
+
+//bump pointer arena which grows a slab at a time. allocate can be called from several threads at once, the other members can't
+//the memory isn't initialized, and it's released all at once by reset, empty or the destructor
 class TinyVectorMemoryAllocator
 {
 public:
-	TinyVectorMemoryAllocator(size_t coverage, size_t length, size_t k);
+	static const size_t defaultSlabSize = 1 << 20;
+	TinyVectorMemoryAllocator();
+	explicit TinyVectorMemoryAllocator(size_t slabSize);
 	~TinyVectorMemoryAllocator();
 	TinyVectorMemoryAllocator(const TinyVectorMemoryAllocator& second) = delete;
 	TinyVectorMemoryAllocator& operator=(const TinyVectorMemoryAllocator& second) = delete;
 	TinyVectorMemoryAllocator(TinyVectorMemoryAllocator&& second);
 	TinyVectorMemoryAllocator& operator=(TinyVectorMemoryAllocator&& second);
 	unsigned char* allocate(size_t size);
+	//forgets all allocations but keeps the slabs for the next ones
+	void reset();
+	//forgets all allocations and releases the slabs
 	void empty();
+	//bytes allocated since the last reset, including the unused ends of full slabs
+	size_t usedBytes() const;
+	//most bytes allocated between resets
+	size_t peakBytes() const;
+	//bytes of the slabs
+	size_t reservedBytes() const;
 private:
-	unsigned char* memory;
-//	std::vector<unsigned char> memory;
-	size_t bytesPerVector;
-	size_t nextEmpty;
-	size_t size;
+	class Slab
+	{
+	public:
+		Slab(size_t size);
+		std::unique_ptr<unsigned char[]> memory;
+		size_t size;
+		std::atomic<size_t> used;
+	};
+	void nextSlab(Slab* full);
+	std::vector<std::unique_ptr<Slab>> slabs;
+	//allocations larger than a slab get a slab of their own, which isn't reused
+	std::vector<std::unique_ptr<Slab>> largeSlabs;
+	size_t currentIndex;
+	std::atomic<Slab*> current;
+	std::mutex growMutex;
+	size_t slabSize;
+	size_t peak;
 };
 
 template <typename T>
@@ -272,6 +337,11 @@ public:
 	size_t actualSize;
 #endif
 	void reserve(size_t numAssignments, TinyVectorMemoryAllocator& allocator);
+	//first position where the assignments differ, or size if they are equal
+	size_t firstDifference(const PartitionAssignments& second, size_t size) const;
+	//log2k bits per assignment, assignment i in bits [i*log2k, (i+1)*log2k) of the little endian bytes
+	unsigned char* rawData();
+	const unsigned char* rawData() const;
 	iterator<PartitionAssignmentElement> begin();
 	iterator<PartitionAssignmentElement> end(size_t size);
 	iterator<PartitionAssignmentElementConst> begin() const;
@@ -281,14 +351,13 @@ private:
 	void extendCapacity(size_t newCapacity, size_t defaultValue, TinyVectorMemoryAllocator& allocator);
 	TinyVector<unsigned char> data;
 	friend class PartitionAssignments::PartitionAssignmentElement;
-	friend bool partitionCompare(const SolidPartition& left, const SolidPartition& right, size_t size);
 };
 
 class SolidPartition
 {
 public:
 	SolidPartition();
-	static std::vector<SolidPartition> getAllPartitions(size_t start, size_t end, TinyVectorMemoryAllocator& allocator);
+	static std::vector<SolidPartition> getAllPartitions(size_t start, size_t end, TinyVectorMemoryAllocator& allocator, ThreadPool& pool);
 	template <typename Iterator>
 	SolidPartition(Iterator start, Iterator end, size_t numAssignments, TinyVectorMemoryAllocator& allocator);
 	void unpermutate(size_t size);
@@ -303,18 +372,175 @@ class SparsePartition
 public:
 	SparsePartition();
 	SparsePartition(SolidPartition inner);
-	static std::vector<SparsePartition> getAllPartitions(std::set<size_t> actives, TinyVectorMemoryAllocator& allocator);
-	SolidPartition getSolid(const std::set<size_t>& actives, TinyVectorMemoryAllocator& allocator) const;
-	SolidPartition getSolidFromIndices(const std::set<size_t>& pickThese, TinyVectorMemoryAllocator& allocator) const;
-	double deltaCost(const Column& col, const std::set<size_t>& actives) const;
+	static std::vector<SparsePartition> getAllPartitions(const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator, ThreadPool& pool);
+	SolidPartition getSolid(const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator) const;
+	SolidPartition getSolidFromIndices(const std::vector<size_t>& pickThese, TinyVectorMemoryAllocator& allocator) const;
+	double deltaCost(const Column& col, const ActiveRowSet& actives) const;
 	size_t getk() const;
-	size_t getAssignment(size_t loc, const std::set<size_t>& actives) const;
+	size_t getAssignment(size_t loc, const ActiveRowSet& actives) const;
 
 	SolidPartition inner;
 private:
-	SolidPartition getSubset(const std::set<size_t>& subset, const std::set<size_t>& actives, TinyVectorMemoryAllocator& allocator) const;
+	SolidPartition getSubset(const ActiveRowSet& subset, const ActiveRowSet& actives, TinyVectorMemoryAllocator& allocator) const;
+};
+
+//how partitions of consecutive columns are matched on the rows they share
+enum class ExtensionJoin
+{
+	//sort the projections of both columns and merge them
+	SortMerge,
+	//hash table of the old column's projections
+	Hash,
+	//generate the new column's partitions from the classes of the old column's projections, so they don't need to be matched
+	Enumerate
+};
+
+//keeps only the cheapest partitions of each column instead of all of them. width 0 is the exact DP
+//the result is then not necessarily optimal. a lower bound for the optimal score is written to cerr, from the cheapest dropped partition
+//of each block and a bound for the columns after it from their variants' weights
+class BeamSettings
+{
+public:
+	BeamSettings();
+	BeamSettings(size_t width, double margin, size_t marginLimit);
+	//number of cheapest partitions kept per column
+	size_t width;
+	//partitions costing at most margin more than the cheapest one are kept as well, up to marginLimit more than width
+	double margin;
+	size_t marginLimit;
+};
+
+//writes the DP's partitions and traceback to path every everyColumns SNPs or everySeconds seconds, whichever comes first. 0 disables either
+//the file is written in the background and replaced atomically. with resume the run continues from the file if it exists
+//a file from a run with other supports or settings, or a truncated one, throws std::runtime_error
+//a finished run leaves its result in the file, so resuming it again returns at once
+class CheckpointSettings
+{
+public:
+	CheckpointSettings();
+	CheckpointSettings(std::string path, size_t everyColumns, double everySeconds, bool resume);
+	//empty for no checkpoints
+	std::string path;
+	size_t everyColumns;
+	double everySeconds;
+	bool resume;
+};
+
+//per column run of the DP: SNPs, active rows, partitions, milliseconds per phase and bytes in the arenas and the traceback
+//written as CSV, or as one JSON object per line if path ends in .json. quiet leaves the per-column lines out of the log
+class TraceSettings
+{
+public:
+	TraceSettings();
+	TraceSettings(std::string path, bool quiet);
+	//empty for no trace. blocks and windows haplotyped separately are written one after another in order, with the SNPs numbered as in all the supports
+	std::string path;
+	bool quiet;
+};
+
+//how the functions below haplotype. the defaults are the exact DP on one thread
+class HaplotyperOptions
+{
+public:
+	HaplotyperOptions();
+	size_t numThreads;
+	ExtensionJoin join;
+	BeamSettings beam;
+	//drops the partitions which can't be optimal anymore, using the score of a narrow beam as an upper bound. the result is still optimal
+	bool prune;
+	//the SNPs are cut into blocks where at most maxBridgingRows rows span the cut, and the blocks are haplotyped concurrently
+	//the result is optimal with 0, otherwise the rows spanning a cut are split and the blocks are relabeled to agree on them as much as possible.
+	//the result is then approximate, its score is recomputed over all supports and a lower bound for the optimal score is written to the log
+	//only haplotype and haplotypeAlternatives cut at bridged rows
+	size_t maxBridgingRows;
+	//each block has its own checkpoint file, path.blockN, when there are several
+	CheckpointSettings checkpoint;
+	TraceSettings trace;
+};
+
+std::tuple<std::vector<size_t>, double> haplotype(const SupportMatrix& supports, size_t k, const HaplotyperOptions& options = HaplotyperOptions());
+//the numSolutions cheapest haplotypings and how confidently each read is assigned, from a backward pass over the kept partitions of every column
+//exact without the beam or the pruning. otherwise they only cover the kept partitions, with the pruning margins up to the bound minus the optimal cost are still exact
+//the kept partitions are held until the end, so the memory grows with the number of columns, and the checkpoints only hold the result
+class HaplotypeAlternatives
+{
+public:
+	//cheapest first, the first one is haplotype's result. fewer than asked for if there are no more, or the pruning or the beam dropped them
+	std::vector<std::tuple<std::vector<size_t>, double>> solutions;
+	//per read, how much more the cheapest haplotyping costs which puts the read in a set with different reads than the optimal one at some SNP. infinite if there is none
+	std::vector<double> margins;
+};
+
+HaplotypeAlternatives haplotypeAlternatives(const SupportMatrix& supports, size_t k, size_t numSolutions, const HaplotyperOptions& options = HaplotyperOptions());
+//cuts the SNPs into windows of windowSize SNPs overlapping the next one by overlap SNPs, and haplotypes the windows concurrently
+//each window is relabeled to agree with the ones before it on the rows they share. a row takes its set from the window which holds the middle of the row
+//when the window is cut at the middle of its overlaps, so rows near a window's edge are taken from the neighbouring window. each window has its own checkpoint file, path.windowN
+//memory is bounded by the largest windows running at once. the result is not necessarily optimal, its score is recomputed over all supports
+std::tuple<std::vector<size_t>, double> haplotypeWindows(const SupportMatrix& supports, size_t k, size_t windowSize, size_t overlap, const HaplotyperOptions& options = HaplotyperOptions());
+//reads the columns one at a time from a supports file sorted by SNP, so only the supports and active rows of the current column are in memory
+std::tuple<std::vector<size_t>, double> haplotypeStreaming(std::string supportsFile, size_t k, const HaplotyperOptions& options = HaplotyperOptions());
+
+class DPWorkspace;
+
+//the functions above for many inputs with the same k and options. keeps its thread pool, partition arenas and traceback between the runs,
+//and one set per thread for the blocks and windows haplotyped concurrently, so later runs don't allocate them again. the runs of one Haplotyper must not overlap, separate Haplotypers can run at the same time
+class Haplotyper
+{
+public:
+	Haplotyper(size_t k, const HaplotyperOptions& options = HaplotyperOptions());
+	~Haplotyper();
+	Haplotyper(const Haplotyper& second) = delete;
+	Haplotyper& operator=(const Haplotyper& second) = delete;
+	size_t getk() const;
+	const HaplotyperOptions& getOptions() const;
+	std::tuple<std::vector<size_t>, double> haplotype(const SupportMatrix& supports);
+	HaplotypeAlternatives haplotypeAlternatives(const SupportMatrix& supports, size_t numSolutions);
+	std::tuple<std::vector<size_t>, double> haplotypeWindows(const SupportMatrix& supports, size_t windowSize, size_t overlap);
+	std::tuple<std::vector<size_t>, double> haplotypeStreaming(std::string supportsFile);
+private:
+	size_t k;
+	HaplotyperOptions options;
+	std::unique_ptr<DPWorkspace> workspace;
+};
+
+//number of partitions of coverage rows into at most k sets, saturating at the maximum size_t
+size_t getNumberOfPartitions(size_t coverage, size_t k);
+
+//memory of haplotype or haplotypeStreaming predicted from the active rows before running the DP
+class MemoryPlan
+{
+public:
+	//partitions per SNP, saturating at the maximum size_t
+	std::vector<size_t> states;
+	//SNP with the most partitions
+	size_t largestColumn;
+	//partition arenas of the column which needs the most
+	size_t peakArenaBytes;
+	//upper bound for the traceback
+	size_t peakTracebackBytes;
+	//upper bound for the arenas, partition vectors and traceback at once, summed over the independent blocks haplotyped at the same time
+	size_t peakBytes;
+};
+
+//the active rows of every SNP from one sweep over the supports, so that the memory for any beam is predicted without reading them again
+class MemoryPlanner
+{
+public:
+	MemoryPlanner(const SupportMatrix& supports, size_t k, size_t numThreads = 1);
+	//a supports file sorted by SNP, haplotyped by haplotypeStreaming
+	MemoryPlanner(std::string supportsFile, size_t k);
+	MemoryPlan plan(BeamSettings beam = BeamSettings()) const;
+private:
+	void record(ActiveRowSweep& sweep);
+	size_t k;
+	size_t concurrentBlocks;
+	//per SNP, the active rows and the rows whose first and last SNP it is
+	std::vector<size_t> coverage;
+	std::vector<size_t> starting;
+	std::vector<size_t> ending;
 };
 
-std::tuple<std::vector<size_t>, double> haplotype(std::vector<SNPSupport> supports, size_t k);
+MemoryPlan planMemory(const SupportMatrix& supports, size_t k, size_t numThreads = 1, BeamSettings beam = BeamSettings());
+MemoryPlan planMemoryStreaming(std::string supportsFile, size_t k, BeamSettings beam = BeamSettings());
 
 #endif
\ No newline at end of file
@@ -1,14 +1,270 @@
-//g++ haplotyper_main.cpp haplotyper.cpp variant_utils.cpp fasta_utils.cpp -std=c++11 -o haplotyper_main.exe
-//./haplotyper_main.exe supportsFile k
+//g++ haplotyper_main.cpp haplotyper.cpp variant_utils.cpp fasta_utils.cpp thread_pool.cpp -std=c++11 -pthread -o haplotyper_main.exe
+//./haplotyper_main.exe supportsFile k [numThreads] [--stream] [--join=enumerate|hash|sort] [--beam=width] [--margin=cost] [--prune] [--bridge=rows] [--plan] [--budget=bytes[K|M|G]] [--over-budget=refuse|beam] [--checkpoint=file] [--checkpoint-columns=N] [--checkpoint-seconds=T] [--resume] [--trace=file.csv|file.json] [--quiet] [--alternatives=N] [--window=snps] [--overlap=snps]
+//--stream reads the supports one column at a time instead of loading the whole file, the file must be sorted by SNP
+//--join picks how the partitions of consecutive columns are matched, enumerate is the default
+//--beam keeps only the width cheapest partitions per column, and up to width more within --margin of the cheapest. the result may not be optimal, a lower bound for the optimal score is written to stderr
+//--prune drops partitions which can't become optimal, the result is still optimal
+//--bridge also cuts the SNPs into separately haplotyped blocks where at most rows reads span the cut. the result is then approximate, and a lower bound for the optimal score is written to stderr. without --stream only
+//--window haplotypes windows of that many SNPs concurrently, each overlapping the next by --overlap SNPs (a quarter of the window by default), and relabels them to agree on the reads they share. the result may not be optimal. without --stream only
+//--plan writes the predicted partitions per SNP instead of haplotyping
+//--budget checks the predicted peak memory before haplotyping. over it the run is refused, or with --over-budget=beam haplotyped with the widest beam that fits
+//--checkpoint saves the DP to file every N SNPs or T seconds, every 600 seconds by default, and --resume continues from it after a crash or kill
+//--trace writes the rows, partitions, milliseconds per phase and memory of every column, --quiet leaves the per-column lines out of stderr
+//--alternatives writes the N cheapest haplotypings found, each as the assignment and score lines, and then a line with each read's margin: the extra cost of the cheapest haplotyping which groups the read with different reads at some SNP. exact without --beam and --prune, without --stream only
 
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <stdexcept>
 
 #include "haplotyper.h"
 
+size_t parseBytes(std::string str)
+{
+	const std::pair<char, size_t> units[] { { 'K', (size_t)1 << 10 }, { 'M', (size_t)1 << 20 }, { 'G', (size_t)1 << 30 } };
+	size_t unit = 1;
+	for (const auto& x : units)
+	{
+		if (str.size() > 0 && str.back() == x.first)
+		{
+			unit = x.second;
+			str.pop_back();
+			break;
+		}
+	}
+	return std::stod(str)*unit;
+}
+
+void reportPlan(const MemoryPlan& plan)
+{
+	std::cerr << "predicted " << plan.states[plan.largestColumn] << " partitions at most (SNP " << plan.largestColumn << "), arenas " << plan.peakArenaBytes << " bytes, traceback at most " << plan.peakTracebackBytes << " bytes, peak at most " << plan.peakBytes << " bytes\n";
+}
+
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
-	auto result = haplotype(supports, std::stoi(argv[2]));
+	HaplotyperOptions options;
+	options.checkpoint = CheckpointSettings { "", 0, 600, false };
+	bool stream = false;
+	bool showPlan = false;
+	size_t budget = 0;
+	bool overBudgetBeam = false;
+	size_t numAlternatives = 0;
+	size_t windowSize = 0;
+	size_t overlap = std::numeric_limits<size_t>::max();
+	for (int i = 3; i < argc; i++)
+	{
+		if (std::string { argv[i] } == "--stream")
+		{
+			stream = true;
+		}
+		else if (std::string { argv[i] } == "--prune")
+		{
+			options.prune = true;
+		}
+		else if (std::string { argv[i] } == "--join=sort")
+		{
+			options.join = ExtensionJoin::SortMerge;
+		}
+		else if (std::string { argv[i] } == "--join=hash")
+		{
+			options.join = ExtensionJoin::Hash;
+		}
+		else if (std::string { argv[i] } == "--join=enumerate")
+		{
+			options.join = ExtensionJoin::Enumerate;
+		}
+		else if (std::string { argv[i] }.substr(0, 7) == "--beam=")
+		{
+			options.beam.width = std::stoi(std::string { argv[i] }.substr(7));
+			options.beam.marginLimit = options.beam.width;
+		}
+		else if (std::string { argv[i] } == "--plan")
+		{
+			showPlan = true;
+		}
+		else if (std::string { argv[i] }.substr(0, 9) == "--budget=")
+		{
+			budget = parseBytes(std::string { argv[i] }.substr(9));
+		}
+		else if (std::string { argv[i] } == "--over-budget=beam")
+		{
+			overBudgetBeam = true;
+		}
+		else if (std::string { argv[i] } == "--over-budget=refuse")
+		{
+			overBudgetBeam = false;
+		}
+		else if (std::string { argv[i] }.substr(0, 9) == "--bridge=")
+		{
+			options.maxBridgingRows = std::stoi(std::string { argv[i] }.substr(9));
+		}
+		else if (std::string { argv[i] }.substr(0, 13) == "--checkpoint=")
+		{
+			options.checkpoint.path = std::string { argv[i] }.substr(13);
+		}
+		else if (std::string { argv[i] }.substr(0, 21) == "--checkpoint-columns=")
+		{
+			options.checkpoint.everyColumns = std::stoi(std::string { argv[i] }.substr(21));
+		}
+		else if (std::string { argv[i] }.substr(0, 21) == "--checkpoint-seconds=")
+		{
+			options.checkpoint.everySeconds = std::stod(std::string { argv[i] }.substr(21));
+		}
+		else if (std::string { argv[i] } == "--resume")
+		{
+			options.checkpoint.resume = true;
+		}
+		else if (std::string { argv[i] }.substr(0, 8) == "--trace=")
+		{
+			options.trace.path = std::string { argv[i] }.substr(8);
+		}
+		else if (std::string { argv[i] } == "--quiet")
+		{
+			options.trace.quiet = true;
+		}
+		else if (std::string { argv[i] }.substr(0, 15) == "--alternatives=")
+		{
+			numAlternatives = std::stoi(std::string { argv[i] }.substr(15));
+		}
+		else if (std::string { argv[i] }.substr(0, 9) == "--window=")
+		{
+			windowSize = std::stoi(std::string { argv[i] }.substr(9));
+		}
+		else if (std::string { argv[i] }.substr(0, 10) == "--overlap=")
+		{
+			overlap = std::stoi(std::string { argv[i] }.substr(10));
+		}
+		else if (std::string { argv[i] }.substr(0, 9) == "--margin=")
+		{
+			options.beam.margin = std::stod(std::string { argv[i] }.substr(9));
+		}
+		else
+		{
+			options.numThreads = std::stoi(argv[i]);
+		}
+	}
+	if (numAlternatives > 0 && stream)
+	{
+		std::cerr << "--alternatives needs the supports in memory, without --stream\n";
+		return 1;
+	}
+	if (windowSize > 0 && (stream || numAlternatives > 0))
+	{
+		std::cerr << "--window can't be used with --stream or --alternatives\n";
+		return 1;
+	}
+	if (overlap == std::numeric_limits<size_t>::max())
+	{
+		overlap = windowSize/4;
+	}
+	if (windowSize > 0 && overlap >= windowSize)
+	{
+		std::cerr << "--overlap must be less than --window\n";
+		return 1;
+	}
+	if (options.checkpoint.resume && options.checkpoint.path.size() == 0)
+	{
+		std::cerr << "--resume needs the --checkpoint file\n";
+		return 1;
+	}
+	size_t k = std::stoi(argv[2]);
+	std::tuple<std::vector<size_t>, double> result;
+	try
+	{
+		SupportMatrix supports;
+		if (!stream)
+		{
+			supports = loadSupportMatrix(argv[1]);
+		}
+		//one sweep over the supports, every plan is computed from it
+		auto makePlanner = [&]() { return stream ? MemoryPlanner { argv[1], k } : MemoryPlanner { supports, k, options.numThreads }; };
+		if (showPlan)
+		{
+			MemoryPlan predicted = makePlanner().plan(options.beam);
+			reportPlan(predicted);
+			for (size_t i = 0; i < predicted.states.size(); i++)
+			{
+				std::cout << i << " " << predicted.states[i] << "\n";
+			}
+			return 0;
+		}
+		if (budget > 0)
+		{
+			MemoryPlanner planner = makePlanner();
+			MemoryPlan predicted = planner.plan(options.beam);
+			reportPlan(predicted);
+			if (predicted.peakBytes > budget && overBudgetBeam && options.beam.width == 0)
+			{
+				//the peak grows with the width, so the widest power of two up to 1 << 20 which fits is binary searched by its exponent
+				size_t low = 0;
+				size_t high = 20;
+				while (low < high)
+				{
+					size_t mid = (low+high+1)/2;
+					size_t width = (size_t)1 << mid;
+					if (planner.plan(BeamSettings { width, options.beam.margin, width }).peakBytes <= budget)
+					{
+						low = mid;
+					}
+					else
+					{
+						high = mid-1;
+					}
+				}
+				size_t width = (size_t)1 << low;
+				predicted = planner.plan(BeamSettings { width, options.beam.margin, width });
+				if (predicted.peakBytes <= budget)
+				{
+					std::cerr << "over the budget of " << budget << " bytes, switching to a beam of " << width << "\n";
+					options.beam = BeamSettings { width, options.beam.margin, width };
+					reportPlan(predicted);
+				}
+			}
+			if (predicted.peakBytes > budget)
+			{
+				std::cerr << "predicted peak of " << predicted.peakBytes << " bytes is over the budget of " << budget << " bytes\n";
+				return 1;
+			}
+		}
+		if (numAlternatives > 0)
+		{
+			HaplotypeAlternatives alternatives = haplotypeAlternatives(supports, k, numAlternatives, options);
+			for (const auto& solution : alternatives.solutions)
+			{
+				for (auto x = std::get<0>(solution).begin(); x != std::get<0>(solution).end(); x++)
+				{
+					std::cout << *x << " ";
+				}
+				std::cout << "\n";
+				std::cout << std::get<1>(solution);
+				std::cout << "\n";
+			}
+			for (auto x = alternatives.margins.begin(); x != alternatives.margins.end(); x++)
+			{
+				std::cout << *x << " ";
+			}
+			std::cout << "\n";
+			return 0;
+		}
+		if (windowSize > 0)
+		{
+			result = haplotypeWindows(supports, k, windowSize, overlap, options);
+		}
+		else if (stream)
+		{
+			result = haplotypeStreaming(argv[1], k, options);
+		}
+		else
+		{
+			result = haplotype(supports, k, options);
+		}
+	}
+	//supports which don't fit in the matrix, or a checkpoint which can't be resumed from
+	catch (const std::runtime_error& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
 	for (auto x = std::get<0>(result).begin(); x != std::get<0>(result).end(); x++)
 	{
 		std::cout << *x << " ";
@@ -16,4 +272,4 @@ int main(int argc, char** argv)
 	std::cout << "\n";
 	std::cout << std::get<1>(result);
 	std::cout << "\n";
-}
\ No newline at end of file
+}
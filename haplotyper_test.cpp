@@ -1,11 +1,196 @@
-//g++ haplotyper_test.cpp haplotyper.cpp variant_utils.cpp fasta_utils.cpp -std=c++11 -o haplotyper_test.exe
+//g++ haplotyper_test.cpp haplotyper.cpp variant_utils.cpp fasta_utils.cpp thread_pool.cpp -std=c++11 -pthread -o haplotyper_test.exe
 //./haplotyperTest.exe
 
 #include <iostream>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
 
 #include "haplotyper.h"
 
+//removes a checkpoint file and the ones of its blocks
+void removeCheckpoint(std::string path)
+{
+	std::remove(path.c_str());
+	for (size_t i = 0; i < 16; i++)
+	{
+		std::remove((path + ".block" + std::to_string(i)).c_str());
+	}
+}
+
+//every exact way of haplotyping gives the optimal score
+void checkOptimal(const std::vector<SNPSupport>& supports, size_t k, double optimal)
+{
+	SupportMatrix matrix { supports };
+	std::vector<HaplotyperOptions> exact;
+	for (auto join : { ExtensionJoin::Enumerate, ExtensionJoin::Hash, ExtensionJoin::SortMerge })
+	{
+		HaplotyperOptions options;
+		options.join = join;
+		exact.push_back(options);
+		options.numThreads = 4;
+		exact.push_back(options);
+	}
+	HaplotyperOptions pruned;
+	pruned.prune = true;
+	exact.push_back(pruned);
+	HaplotyperOptions wideBeam;
+	wideBeam.beam = BeamSettings { 1 << 20, 0, 0 };
+	exact.push_back(wideBeam);
+	std::string supportsFile = "haplotyper_test_supports.tmp";
+	writeSupports(matrix, supportsFile);
+	for (size_t i = 0; i < exact.size(); i++)
+	{
+		auto inMemory = haplotype(matrix, k, exact[i]);
+		auto streamed = haplotypeStreaming(supportsFile, k, exact[i]);
+		auto cheapest = haplotypeAlternatives(matrix, k, 1, exact[i]).solutions[0];
+		assert(std::get<1>(inMemory) == optimal);
+		assert(std::get<1>(streamed) == optimal);
+		assert(std::get<1>(cheapest) == optimal);
+		//the multithreaded run of a join is the next one after the serial run, and gives the same assignments
+		if (exact[i].numThreads > 1)
+		{
+			assert(inMemory == haplotype(matrix, k, exact[i-1]));
+			assert(streamed == haplotypeStreaming(supportsFile, k, exact[i-1]));
+			assert(cheapest == haplotypeAlternatives(matrix, k, 1, exact[i-1]).solutions[0]);
+		}
+	}
+	std::remove(supportsFile.c_str());
+	HaplotyperOptions checkpointed;
+	checkpointed.checkpoint = CheckpointSettings { "haplotyper_test_checkpoint.tmp", 1, 0, false };
+	removeCheckpoint(checkpointed.checkpoint.path);
+	assert(std::get<1>(haplotype(matrix, k, checkpointed)) == optimal);
+	checkpointed.checkpoint.resume = true;
+	assert(std::get<1>(haplotype(matrix, k, checkpointed)) == optimal);
+	removeCheckpoint(checkpointed.checkpoint.path);
+}
+
+//one Haplotyper gives the same results as the one-shot functions over several inputs, and so do two running at once
+void checkReuse(const std::vector<std::vector<SNPSupport>>& inputs, size_t k)
+{
+	HaplotyperOptions options;
+	options.numThreads = 4;
+	std::vector<SupportMatrix> matrices;
+	std::vector<std::tuple<std::vector<size_t>, double>> expected;
+	for (const auto& input : inputs)
+	{
+		matrices.emplace_back(input);
+		expected.push_back(haplotype(matrices.back(), k, options));
+	}
+	Haplotyper haplotyper { k, options };
+	for (size_t repeat = 0; repeat < 2; repeat++)
+	{
+		for (size_t i = 0; i < matrices.size(); i++)
+		{
+			assert(haplotyper.haplotype(matrices[i]) == expected[i]);
+			assert(haplotyper.haplotypeAlternatives(matrices[i], 1).solutions[0] == expected[i]);
+			assert(haplotyper.haplotypeWindows(matrices[i], 3, 1) == haplotypeWindows(matrices[i], k, 3, 1, options));
+		}
+	}
+	std::vector<std::vector<std::tuple<std::vector<size_t>, double>>> concurrent;
+	concurrent.resize(2);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < 2; t++)
+	{
+		threads.emplace_back([&matrices, &concurrent, &options, k, t]()
+		{
+			Haplotyper own { k, options };
+			for (size_t repeat = 0; repeat < 10; repeat++)
+			{
+				for (const auto& matrix : matrices)
+				{
+					concurrent[t].push_back(own.haplotype(matrix));
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	for (size_t t = 0; t < 2; t++)
+	{
+		for (size_t i = 0; i < concurrent[t].size(); i++)
+		{
+			assert(concurrent[t][i] == expected[i % matrices.size()]);
+		}
+	}
+}
+
+bool sameSupports(const std::vector<SNPSupport>& left, const std::vector<SNPSupport>& right)
+{
+	if (left.size() != right.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < left.size(); i++)
+	{
+		if (left[i].readNum != right[i].readNum || left[i].SNPnum != right[i].SNPnum || left[i].variant != right[i].variant || left[i].support != right[i].support)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//text files parsed field by field, malformed lines, and the binary format written and read back
+void checkSupportFiles()
+{
+	std::string textFile = "haplotyper_test_text.tmp";
+	std::string binaryFile = "haplotyper_test_supports.bin";
+	//an exponent and a long mantissa go through strtod, an empty line is skipped, and the last line has no newline
+	{
+		std::ofstream file { textFile };
+		file << "0 0 A 1\n1 0 C 2.5e-1\n\n2 1 G 0.12345678901234567\n3 1 X 7";
+	}
+	assert(TextFileParser::countLines(textFile) == 5);
+	{
+		TextFileParser parser { textFile };
+		size_t read, SNP;
+		char variant;
+		double weight;
+		assert(parser.parseSize(read) && parser.parseSize(SNP) && parser.parseChar(variant) && parser.parseDouble(weight) && parser.atLineEnd());
+		assert(read == 0 && SNP == 0 && variant == 'A' && weight == 1);
+		assert(parser.nextLine());
+		assert(parser.parseSize(read) && parser.parseSize(SNP) && parser.parseChar(variant) && parser.parseDouble(weight) && parser.atLineEnd());
+		assert(weight == 0.25);
+		assert(parser.nextLine() && !parser.atEnd());
+		assert(parser.lineNumber() == 4);
+	}
+	std::vector<SNPSupport> loaded = loadSupports(textFile);
+	std::vector<SNPSupport> expected { { 0, 0, 'A', 1 }, { 1, 0, 'C', 0.25 }, { 2, 1, 'G', 0.12345678901234567 }, { 3, 1, 'X', 7 } };
+	assert(sameSupports(loaded, expected));
+	//sorted by SNP and read already, so the binary file keeps the order
+	writeSupports(loaded, binaryFile);
+	assert(MappedSupportFile::isBinary(binaryFile));
+	assert(sameSupports(loadSupports(binaryFile), expected));
+	SupportMatrix matrix = loadSupportMatrix(binaryFile);
+	assert(sameSupports(matrix.toSupports(), expected));
+	//the malformed lines are counted after the whole file is read
+	{
+		std::ofstream file { textFile };
+		file << "0 0 A 1\nx 0 A 1\n1 1 C\n2 2 T 1\n";
+	}
+	SupportFileReader reader { textFile };
+	SNPSupport support { 0, 0, 'A', 0 };
+	assert(reader.next(support) && support.readNum == 0);
+	assert(reader.next(support) && support.readNum == 2);
+	bool threw = false;
+	try
+	{
+		reader.next(support);
+	}
+	catch (const std::runtime_error& e)
+	{
+		threw = std::string { e.what() }.find("2 malformed lines") == 0;
+	}
+	assert(threw);
+	std::remove(textFile.c_str());
+	std::remove(binaryFile.c_str());
+}
+
 int main(int argc, char** argv)
 {
 	std::vector<SNPSupport> supports {
@@ -22,19 +207,46 @@ int main(int argc, char** argv)
 		{4, 4, 'T', 1}
 	};
 	std::cout << sizeof(SparsePartition) << "\n";
-	assert(haplotype(supports, 1).second == 6);
-	assert(haplotype(supports, 2).second == 2);
-	assert(haplotype(supports, 3).second == 0);
+	checkSupportFiles();
+	assert(std::get<1>(haplotype(supports, 1)) == 6);
+	assert(std::get<1>(haplotype(supports, 2)) == 2);
+	assert(std::get<1>(haplotype(supports, 3)) == 0);
 	supports[2].variant = 'A';
-	assert(haplotype(supports, 1).second == 6);
-	assert(haplotype(supports, 2).second == 1);
-	assert(haplotype(supports, 3).second == 0);
+	assert(std::get<1>(haplotype(supports, 1)) == 6);
+	assert(std::get<1>(haplotype(supports, 2)) == 1);
+	assert(std::get<1>(haplotype(supports, 3)) == 0);
 	supports[7].variant = 'G';
-	assert(haplotype(supports, 1).second == 6);
-	assert(haplotype(supports, 2).second == 2);
-	assert(haplotype(supports, 3).second == 0);
+	assert(std::get<1>(haplotype(supports, 1)) == 6);
+	assert(std::get<1>(haplotype(supports, 2)) == 2);
+	assert(std::get<1>(haplotype(supports, 3)) == 0);
 	supports[6].variant = 'A';
-	assert(haplotype(supports, 1).second == 5);
-	assert(haplotype(supports, 2).second == 1);
-	assert(haplotype(supports, 3).second == 0);
-}
\ No newline at end of file
+	assert(std::get<1>(haplotype(supports, 1)) == 5);
+	assert(std::get<1>(haplotype(supports, 2)) == 1);
+	assert(std::get<1>(haplotype(supports, 3)) == 0);
+	//a second copy after a SNP which no read spans is haplotyped separately, the optimum doubles
+	std::vector<SNPSupport> withGap = supports;
+	for (auto x : supports)
+	{
+		withGap.push_back(SNPSupport { x.readNum+4, x.SNPnum+5, x.variant, x.support });
+	}
+	for (size_t k = 1; k <= 3; k++)
+	{
+		double optimal = std::get<1>(haplotype(supports, k));
+		checkOptimal(supports, k, optimal);
+		checkOptimal(withGap, k, 2*optimal);
+		checkReuse({ supports, withGap }, k);
+	}
+	//reads of 7 SNPs starting every 3/4 SNPs, so that the columns have more partitions than the threads' chunks of work
+	std::vector<SNPSupport> deep;
+	uint64_t seed = 1;
+	for (size_t read = 0; read < 40; read++)
+	{
+		for (size_t SNP = read*3/4; SNP < read*3/4+7; SNP++)
+		{
+			seed = seed*6364136223846793005 + 1442695040888963407;
+			bool error = (seed >> 60) < 3;
+			deep.push_back(SNPSupport { read, SNP, "AC"[(read % 2) ^ error], 1.0 + (seed >> 62) });
+		}
+	}
+	checkOptimal(deep, 3, std::get<1>(haplotype(deep, 3)));
+}
@@ -4,228 +4,610 @@
 #include <unordered_map>
 #include <algorithm>
 #include <iostream>
+#include <functional>
+#include <queue>
+#include <map>
 
 #include "variant_utils.h"
 
-size_t findSNPWithHighestNecessaryCoverage(const std::vector<SNPSupport>& supports, size_t minCoverage)
+//coverage per SNP with range updates and a query for the leftmost SNP with the highest coverage
+class CoverageTree
 {
-	size_t maxSNP = 0;
-	for (auto x : supports)
+public:
+	CoverageTree(const std::vector<size_t>& coverages);
+	//adds delta to the coverage of SNPs start to end, inclusive
+	void add(size_t start, size_t end, int64_t delta);
+	size_t get(size_t SNP) const;
+	size_t highest() const;
+private:
+	void build(size_t node, size_t nodeStart, size_t nodeEnd, const std::vector<size_t>& coverages);
+	void add(size_t node, size_t nodeStart, size_t nodeEnd, size_t start, size_t end, int64_t delta);
+	size_t size;
+	//adds is the pending addition to the whole subtree, maxs the highest sum of adds from the node to a leaf
+	std::vector<int64_t> adds;
+	std::vector<int64_t> maxs;
+};
+
+CoverageTree::CoverageTree(const std::vector<size_t>& coverages) :
+	size(coverages.size()),
+	adds(),
+	maxs()
+{
+	assert(size > 0);
+	adds.resize(size*4, 0);
+	maxs.resize(size*4, 0);
+	build(1, 0, size-1, coverages);
+}
+
+void CoverageTree::build(size_t node, size_t nodeStart, size_t nodeEnd, const std::vector<size_t>& coverages)
+{
+	if (nodeStart == nodeEnd)
 	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
+		adds[node] = coverages[nodeStart];
+		maxs[node] = coverages[nodeStart];
+		return;
 	}
-	maxSNP++;
-	std::vector<size_t> coverages;
-	coverages.resize(maxSNP, 0);
-	for (auto x : supports)
+	size_t mid = (nodeStart + nodeEnd) / 2;
+	build(node*2, nodeStart, mid, coverages);
+	build(node*2+1, mid+1, nodeEnd, coverages);
+	maxs[node] = std::max(maxs[node*2], maxs[node*2+1]);
+}
+
+void CoverageTree::add(size_t start, size_t end, int64_t delta)
+{
+	assert(start <= end);
+	assert(end < size);
+	add(1, 0, size-1, start, end, delta);
+}
+
+void CoverageTree::add(size_t node, size_t nodeStart, size_t nodeEnd, size_t start, size_t end, int64_t delta)
+{
+	if (end < nodeStart || start > nodeEnd)
 	{
-		coverages[x.SNPnum]++;
+		return;
 	}
-	size_t highestIndex = 0;
-	for (size_t i = 1; i < coverages.size(); i++)
+	if (start <= nodeStart && end >= nodeEnd)
 	{
-		if (coverages[i] > coverages[highestIndex])
-		{
-			highestIndex = i;
-		}
+		adds[node] += delta;
+		maxs[node] += delta;
+		return;
 	}
-	if (coverages[highestIndex] >= minCoverage)
+	size_t mid = (nodeStart + nodeEnd) / 2;
+	add(node*2, nodeStart, mid, start, end, delta);
+	add(node*2+1, mid+1, nodeEnd, start, end, delta);
+	maxs[node] = adds[node] + std::max(maxs[node*2], maxs[node*2+1]);
+}
+
+size_t CoverageTree::get(size_t SNP) const
+{
+	assert(SNP < size);
+	size_t node = 1;
+	size_t nodeStart = 0;
+	size_t nodeEnd = size-1;
+	int64_t result = adds[node];
+	while (nodeStart < nodeEnd)
 	{
-		return highestIndex;
+		size_t mid = (nodeStart + nodeEnd) / 2;
+		if (SNP <= mid)
+		{
+			node = node*2;
+			nodeEnd = mid;
+		}
+		else
+		{
+			node = node*2+1;
+			nodeStart = mid+1;
+		}
+		result += adds[node];
 	}
-	return -1;
+	assert(result >= 0);
+	return result;
 }
 
-size_t findSNPWithHighestTotalCoverage(const std::vector<SNPSupport>& supports, size_t minCoverage)
+size_t CoverageTree::highest() const
 {
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
+	size_t node = 1;
+	size_t nodeStart = 0;
+	size_t nodeEnd = size-1;
+	while (nodeStart < nodeEnd)
 	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
+		size_t mid = (nodeStart + nodeEnd) / 2;
+		if (maxs[node*2] >= maxs[node*2+1])
+		{
+			node = node*2;
+			nodeEnd = mid;
+		}
+		else
+		{
+			node = node*2+1;
+			nodeStart = mid+1;
+		}
 	}
-	maxSNP++;
-	maxRead++;
-	std::vector<std::pair<size_t, size_t>> rowExtents;
-	rowExtents.resize(maxRead, {-1, 0});
-	for (auto x : supports)
+	return nodeStart;
+}
+
+//the supports of left, plus the supports of right not in left, plus twice the supports of right disagreeing with left, minus the supports agreeing
+//lines are sorted by SNP, a SNP with several supports in one line is compared by its first support
+double lineDifference(const SNPLine& left, const SNPLine& right)
+{
+	double result = 0;
+	for (size_t i = 0; i < left.supportsAtLocations.size(); i++)
 	{
-		rowExtents[x.readNum].first = std::min(rowExtents[x.readNum].first, x.SNPnum);
-		rowExtents[x.readNum].second = std::max(rowExtents[x.readNum].second, x.SNPnum);
+		result += left.supportsAtLocations[i];
 	}
-	size_t maxIndex = 0;
-	size_t maxCoverage = 0;
-	for (size_t i = 0; i < maxSNP; i++)
+	size_t leftIndex = 0;
+	size_t rightFirst = 0;
+	for (size_t i = 0; i < right.variantsAtLocations.size(); i++)
 	{
-		size_t currentCoverage = 0;
-		for (size_t j = 0; j < maxRead; j++)
+		size_t SNP = right.variantsAtLocations[i].first;
+		if (right.variantsAtLocations[rightFirst].first != SNP)
+		{
+			rightFirst = i;
+		}
+		while (leftIndex < left.variantsAtLocations.size() && left.variantsAtLocations[leftIndex].first < SNP)
 		{
-			if (rowExtents[j].first <= i && rowExtents[j].second >= i)
+			leftIndex++;
+		}
+		if (leftIndex < left.variantsAtLocations.size() && left.variantsAtLocations[leftIndex].first == SNP)
+		{
+			if (left.variantsAtLocations[leftIndex].second != right.variantsAtLocations[i].second)
 			{
-				currentCoverage++;
+				result += right.supportsAtLocations[rightFirst]*2+left.supportsAtLocations[leftIndex];
+			}
+			else
+			{
+				result -= left.supportsAtLocations[leftIndex];
 			}
 		}
-		if (currentCoverage > maxCoverage)
+		else
 		{
-			maxCoverage = currentCoverage;
-			maxIndex = i;
+			result += right.supportsAtLocations[rightFirst];
 		}
 	}
-	if (maxCoverage >= minCoverage)
+	return result;
+}
+
+//a row of the merged matrix, named by the read number it keeps
+class MergeRow
+{
+public:
+	SNPLine line;
+	//index of each support in the input matrix. only kept for rows which haven't been merged
+	std::vector<size_t> inputPositions;
+	//number of the merge which made this row, 0 if it hasn't been merged
+	size_t mergedAt;
+	bool alive;
+	//input reads renumbered to this row
+	std::vector<size_t> members;
+};
+
+//a pair of rows at a SNP. left is the higher read number
+//stale once either row has been merged since the pair was made
+class CandidatePair
+{
+public:
+	bool operator>(const CandidatePair& other) const;
+	double difference;
+	size_t left;
+	size_t right;
+	size_t leftMergedAt;
+	size_t rightMergedAt;
+};
+
+bool CandidatePair::operator>(const CandidatePair& other) const
+{
+	if (difference != other.difference)
 	{
-		return maxIndex;
+		return difference > other.difference;
 	}
-	return -1;
+	if (left != other.left)
+	{
+		return left > other.left;
+	}
+	return right > other.right;
 }
 
-std::vector<SNPLine> filterLines(const std::vector<SNPLine>& lines, size_t SNPposition)
+class SNPCandidates
+{
+public:
+	std::priority_queue<CandidatePair, std::vector<CandidatePair>, std::greater<CandidatePair>> pairs;
+	//rows merged after this merge number have no pairs in the queue yet
+	size_t refreshedAt;
+};
+
+//merges the most similar pair of rows at the most covered SNP until no SNP is over the limit
+//keeps the coverage of each SNP and a queue of row pairs for each over covered SNP, and after a merge updates only the two rows involved
+class RowMerger
+{
+public:
+	RowMerger(const SupportMatrix& supports);
+	//coverage is the number of supports at the SNP, rows are the rows with a support there
+	size_t mergeNecessary(size_t coverageLimit);
+	//coverage is the number of rows spanning the SNP, rows are the rows spanning it
+	size_t mergeTotal(size_t coverageLimit);
+	//supports of unmerged rows in the matrix's order, by SNP and read, then merged rows in the order they were merged
+	std::vector<SNPSupport> getSupports() const;
+	size_t getRenumbering(size_t read) const;
+	size_t numSNPs() const;
+	size_t numReads() const;
+private:
+	std::pair<size_t, size_t> mostSimilarRows(size_t SNP, const std::vector<size_t>& rowsAtSNP);
+	void merge(size_t left, size_t right);
+	void dropCandidates(size_t start, size_t end, const CoverageTree& coverage, size_t coverageLimit);
+	size_t supportOrder(const MergeRow& row, size_t index) const;
+	std::vector<MergeRow> rows;
+	//rows with a support at each SNP
+	std::vector<std::vector<size_t>> columnRows;
+	std::map<size_t, SNPCandidates> candidates;
+	std::vector<size_t> renumbering;
+	size_t numInputSupports;
+	size_t mergeCount;
+};
+
+RowMerger::RowMerger(const SupportMatrix& supports) :
+	rows(),
+	columnRows(),
+	candidates(),
+	renumbering(),
+	numInputSupports(supports.size()),
+	mergeCount(0)
 {
-	std::vector<SNPLine> ret;
-	for (auto x : lines)
+	size_t maxSNP = supports.numSNPs();
+	size_t maxRead = supports.numReads();
+	rows.resize(maxRead);
+	columnRows.resize(maxSNP);
+	renumbering.resize(maxRead);
+	for (size_t i = 0; i < maxRead; i++)
+	{
+		rows[i].line.readNum = i;
+		rows[i].mergedAt = 0;
+		rows[i].alive = false;
+		rows[i].members.push_back(i);
+		renumbering[i] = i;
+	}
+	//each read's supports by SNP from the read index, their positions are the matrix's indices
+	for (size_t read = 0; read < maxRead; read++)
 	{
-		if (std::any_of(x.variantsAtLocations.begin(), x.variantsAtLocations.end(), [SNPposition](std::pair<size_t, char> v) { return v.first == SNPposition; }))
+		MergeRow& row = rows[read];
+		for (size_t position = supports.readStart(read); position < supports.readStart(read+1); position++)
 		{
-			ret.push_back(x);
+			size_t i = supports.readIndex(position);
+			if (row.line.variantsAtLocations.size() == 0 || row.line.variantsAtLocations.back().first != supports.SNP(i))
+			{
+				columnRows[supports.SNP(i)].push_back(read);
+			}
+			row.line.variantsAtLocations.emplace_back(supports.SNP(i), supports.variant(i));
+			row.line.supportsAtLocations.push_back(supports.weight(i));
+			row.inputPositions.push_back(i);
+			row.alive = true;
 		}
 	}
-	return ret;
 }
 
-std::vector<SNPLine> filterLinesAny(const std::vector<SNPLine>& lines, size_t SNPposition)
+size_t RowMerger::numSNPs() const
+{
+	return columnRows.size();
+}
+
+size_t RowMerger::numReads() const
+{
+	return rows.size();
+}
+
+size_t RowMerger::getRenumbering(size_t read) const
+{
+	return renumbering[read];
+}
+
+//position of the support in the support list the merges are defined on. merged rows are appended after the input
+size_t RowMerger::supportOrder(const MergeRow& row, size_t index) const
 {
-	std::vector<SNPLine> ret;
-	for (auto x : lines)
+	if (row.mergedAt == 0)
 	{
-		if (x.variantsAtLocations[0].first <= SNPposition && x.variantsAtLocations.back().first >= SNPposition)
-		{
-			ret.push_back(x);
-		}
+		return row.inputPositions[index];
 	}
-	return ret;
+	return numInputSupports + row.mergedAt;
 }
 
-double lineDifference(SNPLine left, SNPLine right)
+std::pair<size_t, size_t> RowMerger::mostSimilarRows(size_t SNP, const std::vector<size_t>& rowsAtSNP)
 {
-	std::set<size_t> leftSNPs;
-	for (auto x : left.variantsAtLocations)
+	auto found = candidates.find(SNP);
+	bool fresh = found == candidates.end();
+	SNPCandidates& queue = candidates[SNP];
+	std::vector<size_t> changed;
+	for (auto row : rowsAtSNP)
 	{
-		leftSNPs.insert(x.first);
+		if (fresh || rows[row].mergedAt > queue.refreshedAt)
+		{
+			changed.push_back(row);
+		}
 	}
-	double result = 0;
-	for (size_t i = 0; i < left.supportsAtLocations.size(); i++)
+	std::sort(changed.begin(), changed.end());
+	for (auto row : changed)
 	{
-		result += left.supportsAtLocations[i];
+		for (auto other : rowsAtSNP)
+		{
+			if (other == row || (other < row && std::binary_search(changed.begin(), changed.end(), other)))
+			{
+				continue;
+			}
+			size_t left = std::max(row, other);
+			size_t right = std::min(row, other);
+			queue.pairs.push(CandidatePair { lineDifference(rows[left].line, rows[right].line), left, right, rows[left].mergedAt, rows[right].mergedAt });
+		}
 	}
-	for (auto x : right.variantsAtLocations)
+	queue.refreshedAt = mergeCount;
+	while (queue.pairs.size() > 0)
+	{
+		CandidatePair best = queue.pairs.top();
+		queue.pairs.pop();
+		if (rows[best.left].alive && rows[best.right].alive && rows[best.left].mergedAt == best.leftMergedAt && rows[best.right].mergedAt == best.rightMergedAt)
+		{
+			return std::make_pair(best.left, best.right);
+		}
+	}
+	assert(false);
+	return std::make_pair(0, 0);
+}
+
+//same result as mergeRowsForceMerge: supports of the same variant are summed in support list order and the highest is kept, the first on ties
+void RowMerger::merge(size_t left, size_t right)
+{
+	assert(left != right);
+	MergeRow& leftRow = rows[left];
+	MergeRow& rightRow = rows[right];
+	mergeCount++;
+	SNPLine merged;
+	merged.readNum = left;
+	size_t leftIndex = 0;
+	size_t rightIndex = 0;
+	std::vector<std::pair<size_t, std::pair<char, double>>> atSNP;
+	std::vector<std::pair<char, double>> variants;
+	while (leftIndex < leftRow.line.variantsAtLocations.size() || rightIndex < rightRow.line.variantsAtLocations.size())
 	{
-		if (leftSNPs.count(x.first) > 0)
+		size_t SNP = -1;
+		if (leftIndex < leftRow.line.variantsAtLocations.size())
 		{
-			if (left.variantAt(x.first) != x.second)
+			SNP = leftRow.line.variantsAtLocations[leftIndex].first;
+		}
+		if (rightIndex < rightRow.line.variantsAtLocations.size())
+		{
+			SNP = std::min(SNP, rightRow.line.variantsAtLocations[rightIndex].first);
+		}
+		atSNP.clear();
+		while (leftIndex < leftRow.line.variantsAtLocations.size() && leftRow.line.variantsAtLocations[leftIndex].first == SNP)
+		{
+			atSNP.emplace_back(supportOrder(leftRow, leftIndex), std::make_pair(leftRow.line.variantsAtLocations[leftIndex].second, leftRow.line.supportsAtLocations[leftIndex]));
+			leftIndex++;
+		}
+		while (rightIndex < rightRow.line.variantsAtLocations.size() && rightRow.line.variantsAtLocations[rightIndex].first == SNP)
+		{
+			atSNP.emplace_back(supportOrder(rightRow, rightIndex), std::make_pair(rightRow.line.variantsAtLocations[rightIndex].second, rightRow.line.supportsAtLocations[rightIndex]));
+			rightIndex++;
+		}
+		std::sort(atSNP.begin(), atSNP.end(), [](const std::pair<size_t, std::pair<char, double>>& first, const std::pair<size_t, std::pair<char, double>>& second) { return first.first < second.first; });
+		variants.clear();
+		for (const auto& x : atSNP)
+		{
+			bool found = false;
+			for (auto& y : variants)
 			{
-				result += right.supportAt(x.first)*2+left.supportAt(x.first);
+				if (y.first == x.second.first)
+				{
+					y.second += x.second.second;
+					found = true;
+					break;
+				}
 			}
-			else
+			if (!found)
 			{
-				result -= left.supportAt(x.first);
+				variants.push_back(x.second);
 			}
 		}
-		else
+		std::pair<char, double> highestSupport = variants.front();
+		for (const auto& y : variants)
 		{
-			result += right.supportAt(x.first);
+			if (y.second > highestSupport.second)
+			{
+				highestSupport = y;
+			}
 		}
+		merged.variantsAtLocations.emplace_back(SNP, highestSupport.first);
+		merged.supportsAtLocations.push_back(highestSupport.second);
 	}
-	return result;
-
-}
-
-template <typename RowFilter>
-std::pair<size_t, size_t> findMostSimilarRows(const std::vector<SNPSupport>& supports, size_t SNPposition, RowFilter filter)
-{
-	std::vector<SNPLine> lines = makeLines(supports);
-	lines = filter(lines, SNPposition);
-	size_t bestLeft = lines[1].readNum;
-	size_t bestRight = lines[0].readNum;
-	double bestDifference = lineDifference(lines[1], lines[0]);
-	for (size_t i = 0; i < lines.size(); i++)
+	for (const auto& row : { left, right })
 	{
-		for (size_t j = 0; j < i; j++)
+		for (const auto& x : rows[row].line.variantsAtLocations)
 		{
-			double difference = lineDifference(lines[i], lines[j]);
-			assert(std::abs(lineDifference(lines[j], lines[i])-difference) < 0.01);
-			if (difference < bestDifference)
+			auto& column = columnRows[x.first];
+			auto found = std::find(column.begin(), column.end(), row);
+			if (found != column.end())
 			{
-				bestDifference = difference;
-				bestLeft = lines[i].readNum;
-				bestRight = lines[j].readNum;
+				column.erase(found);
 			}
 		}
 	}
-	return std::pair<size_t, size_t> { bestLeft, bestRight };
+	for (const auto& x : merged.variantsAtLocations)
+	{
+		columnRows[x.first].push_back(left);
+	}
+	for (auto read : rightRow.members)
+	{
+		renumbering[read] = left;
+	}
+	leftRow.members.insert(leftRow.members.end(), rightRow.members.begin(), rightRow.members.end());
+	leftRow.line = std::move(merged);
+	leftRow.inputPositions.clear();
+	leftRow.mergedAt = mergeCount;
+	rightRow.alive = false;
+	rightRow.line = SNPLine {};
+	rightRow.inputPositions.clear();
+	rightRow.members.clear();
 }
 
-int main(int argc, char** argv)
+//coverage never grows from a merge, so SNPs which fall under the limit don't need their queues anymore
+void RowMerger::dropCandidates(size_t start, size_t end, const CoverageTree& coverage, size_t coverageLimit)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
-	size_t necessaryCoverageLimit = std::stoi(argv[2]);
-	size_t totalCoverageLimit = std::stoi(argv[3]);
-	size_t mergedRows = 0;
-	SupportRenumbering renumbering;
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
+	auto iter = candidates.lower_bound(start);
+	while (iter != candidates.end() && iter->first <= end)
 	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
+		if (coverage.get(iter->first) < coverageLimit)
+		{
+			iter = candidates.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
 	}
-	maxSNP++;
-	maxRead++;
-	for (size_t i = 0; i < maxSNP; i++)
+}
+
+size_t RowMerger::mergeNecessary(size_t coverageLimit)
+{
+	if (numSNPs() == 0)
 	{
-		renumbering.addSNPRenumbering(i, i);
+		return 0;
 	}
-	for (size_t i = 0; i < maxRead; i++)
+	std::vector<size_t> coverages;
+	coverages.resize(numSNPs(), 0);
+	for (const auto& row : rows)
 	{
-		renumbering.addReadRenumbering(i, i);
+		for (const auto& x : row.line.variantsAtLocations)
+		{
+			coverages[x.first]++;
+		}
 	}
-	std::cerr << maxRead << " lines\n";
+	CoverageTree coverage { coverages };
+	size_t mergedRows = 0;
 	while (true)
 	{
-		size_t SNPposition = findSNPWithHighestNecessaryCoverage(supports, necessaryCoverageLimit);
-		if (SNPposition == -1)
+		size_t SNPposition = coverage.highest();
+		if (coverage.get(SNPposition) < coverageLimit)
 		{
 			break;
 		}
-		std::pair<size_t, size_t> similars = findMostSimilarRows(supports, SNPposition, filterLines);
-		supports = mergeRowsForceMerge(supports, similars.first, similars.second);
-		for (size_t i = 0; i < maxRead; i++)
+		std::pair<size_t, size_t> similars = mostSimilarRows(SNPposition, columnRows[SNPposition]);
+		for (const auto& row : { similars.first, similars.second })
 		{
-			if (renumbering.getReadRenumbering(i) == similars.second)
+			for (const auto& x : rows[row].line.variantsAtLocations)
 			{
-				renumbering.overwriteReadRenumbering(i, similars.first);
+				coverage.add(x.first, x.first, -1);
 			}
 		}
+		merge(similars.first, similars.second);
+		const SNPLine& merged = rows[similars.first].line;
+		for (const auto& x : merged.variantsAtLocations)
+		{
+			coverage.add(x.first, x.first, 1);
+		}
+		dropCandidates(merged.variantsAtLocations.front().first, merged.variantsAtLocations.back().first, coverage, coverageLimit);
 		mergedRows++;
 	}
+	candidates.clear();
+	return mergedRows;
+}
+
+size_t RowMerger::mergeTotal(size_t coverageLimit)
+{
+	if (numSNPs() == 0)
+	{
+		return 0;
+	}
+	std::vector<size_t> coverages;
+	coverages.resize(numSNPs()+1, 0);
+	for (const auto& row : rows)
+	{
+		if (row.alive)
+		{
+			coverages[row.line.variantsAtLocations.front().first]++;
+			coverages[row.line.variantsAtLocations.back().first+1]--;
+		}
+	}
+	for (size_t i = 1; i < coverages.size(); i++)
+	{
+		coverages[i] += coverages[i-1];
+	}
+	coverages.pop_back();
+	CoverageTree coverage { coverages };
+	size_t mergedRows = 0;
+	std::vector<size_t> rowsAtSNP;
 	while (true)
 	{
-		size_t SNPposition = findSNPWithHighestTotalCoverage(supports, totalCoverageLimit);
-		if (SNPposition == -1)
+		size_t SNPposition = coverage.highest();
+		if (coverage.get(SNPposition) < coverageLimit)
 		{
 			break;
 		}
-		std::pair<size_t, size_t> similars = findMostSimilarRows(supports, SNPposition, filterLinesAny);
-		supports = mergeRowsForceMerge(supports, similars.first, similars.second);
-		for (size_t i = 0; i < maxRead; i++)
+		rowsAtSNP.clear();
+		for (size_t i = 0; i < rows.size(); i++)
 		{
-			if (renumbering.getReadRenumbering(i) == similars.second)
+			if (rows[i].alive && rows[i].line.variantsAtLocations.front().first <= SNPposition && rows[i].line.variantsAtLocations.back().first >= SNPposition)
 			{
-				renumbering.overwriteReadRenumbering(i, similars.first);
+				rowsAtSNP.push_back(i);
 			}
 		}
+		std::pair<size_t, size_t> similars = mostSimilarRows(SNPposition, rowsAtSNP);
+		for (const auto& row : { similars.first, similars.second })
+		{
+			coverage.add(rows[row].line.variantsAtLocations.front().first, rows[row].line.variantsAtLocations.back().first, -1);
+		}
+		merge(similars.first, similars.second);
+		const SNPLine& merged = rows[similars.first].line;
+		coverage.add(merged.variantsAtLocations.front().first, merged.variantsAtLocations.back().first, 1);
+		dropCandidates(merged.variantsAtLocations.front().first, merged.variantsAtLocations.back().first, coverage, coverageLimit);
 		mergedRows++;
 	}
+	candidates.clear();
+	return mergedRows;
+}
+
+std::vector<SNPSupport> RowMerger::getSupports() const
+{
+	std::vector<std::pair<size_t, SNPSupport>> ordered;
+	for (const auto& row : rows)
+	{
+		if (!row.alive)
+		{
+			continue;
+		}
+		for (size_t i = 0; i < row.line.variantsAtLocations.size(); i++)
+		{
+			ordered.emplace_back(supportOrder(row, i), SNPSupport { row.line.readNum, row.line.variantsAtLocations[i].first, row.line.variantsAtLocations[i].second, row.line.supportsAtLocations[i] });
+		}
+	}
+	std::stable_sort(ordered.begin(), ordered.end(), [](const std::pair<size_t, SNPSupport>& left, const std::pair<size_t, SNPSupport>& right) { return left.first < right.first; });
+	std::vector<SNPSupport> result;
+	result.reserve(ordered.size());
+	for (const auto& x : ordered)
+	{
+		result.push_back(x.second);
+	}
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	size_t necessaryCoverageLimit = std::stoi(argv[2]);
+	size_t totalCoverageLimit = std::stoi(argv[3]);
+	RowMerger merger { loadSupportMatrix(argv[1]) };
+	SupportRenumbering renumbering;
+	for (size_t i = 0; i < merger.numSNPs(); i++)
+	{
+		renumbering.addSNPRenumbering(i, i);
+	}
+	for (size_t i = 0; i < merger.numReads(); i++)
+	{
+		renumbering.addReadRenumbering(i, i);
+	}
+	std::cerr << merger.numReads() << " lines\n";
+	size_t mergedRows = 0;
+	mergedRows += merger.mergeNecessary(necessaryCoverageLimit);
+	mergedRows += merger.mergeTotal(totalCoverageLimit);
+	for (size_t i = 0; i < merger.numReads(); i++)
+	{
+		renumbering.overwriteReadRenumbering(i, merger.getRenumbering(i));
+	}
 	std::cerr << "merged " << mergedRows << " rows\n";
-	writeSupports(supports, argv[4]);
+	writeSupports(merger.getSupports(), argv[4]);
 	writeRenumbering(renumbering, argv[5]);
-}
\ No newline at end of file
+}
@@ -6,22 +6,17 @@
 
 #include "variant_utils.h"
 
-std::pair<std::vector<SNPSupport>, SupportRenumbering> mergeSubsets(std::vector<SNPSupport> supports)
+std::pair<std::vector<SNPSupport>, SupportRenumbering> mergeSubsets(const SupportMatrix& supports)
 {
-	size_t maxSNP = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-	}
-	maxSNP++;
+	size_t maxSNP = supports.numSNPs();
 	std::cout << "lines ";
 	std::vector<SNPLine> lines = makeLines(supports);
-	for (auto x : lines)
+	for (const auto& x : lines)
 	{
 		assert(x.variantsAtLocations.size() > 0);
 	}
 	std::cout << lines.size() << "\n";
-	std::sort(lines.begin(), lines.end(), [](SNPLine left, SNPLine right) { return left.variantsAtLocations.size() > right.variantsAtLocations.size(); });
+	std::sort(lines.begin(), lines.end(), [](const SNPLine& left, const SNPLine& right) { return left.variantsAtLocations.size() > right.variantsAtLocations.size(); });
 	SupportRenumbering renumbering;
 	std::vector<SNPLine> merged;
 	std::cout << "merge ";
@@ -61,7 +56,7 @@ std::pair<std::vector<SNPSupport>, SupportRenumbering> mergeSubsets(std::vector<
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 	std::pair<std::vector<SNPSupport>, SupportRenumbering> result = mergeSubsets(supports);
 	writeSupports(result.first, argv[2]);
 	writeRenumbering(result.second, argv[3]);
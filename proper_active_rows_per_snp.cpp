@@ -4,41 +4,12 @@
 
 #include "variant_utils.h"
 
-std::vector<size_t> calculateProperActivesPerSNP(const std::vector<SNPSupport>& supports)
+std::vector<size_t> calculateProperActivesPerSNP(const SupportMatrix& supports)
 {
-	size_t numRows = 0;
-	size_t numSNPs = 0;
-	for (auto x : supports)
-	{
-		numRows = std::max(numRows, x.readNum);
-		numSNPs = std::max(numSNPs, x.SNPnum);
-	}
-	numRows++;
-	numSNPs++;
-	std::vector<std::pair<size_t, size_t>> rowExtent;
-	rowExtent.resize(numRows, std::pair<size_t, size_t>{-1, 0});
-	for (auto x : supports)
-	{
-		rowExtent[x.readNum].first = std::min(rowExtent[x.readNum].first, x.SNPnum);
-		rowExtent[x.readNum].second = std::max(rowExtent[x.readNum].second, x.SNPnum);
-	}
-	std::vector<size_t> ret;
-	for (size_t i = 0; i < numSNPs; i++)
-	{
-		size_t num = 0;
-		for (auto x : rowExtent)
-		{
-			if (x.first <= i && x.second >= i)
-			{
-				num++;
-			}
-		}
-		ret.push_back(num);
-	}
-	return ret;
+	return getActiveCoverage(supports);
 }
 
-std::vector<size_t> calculateUsedActivesPerSNP(const std::vector<SNPSupport>& supports)
+std::vector<size_t> calculateUsedActivesPerSNP(const SupportMatrix& supports)
 {
 	size_t numRows = 0;
 	size_t numSNPs = 0;
@@ -74,7 +45,7 @@ std::vector<size_t> calculateUsedActivesPerSNP(const std::vector<SNPSupport>& su
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 	std::vector<size_t> properPerSnp = calculateProperActivesPerSNP(supports);
 	std::vector<size_t> usedPerSnp = calculateUsedActivesPerSNP(supports);
 	for (size_t i = 0; i < properPerSnp.size(); i++)
@@ -5,43 +5,16 @@
 
 #include "variant_utils.h"
 
-size_t findBiggestAccidentalCoverage(std::vector<SNPSupport> supports, size_t minCoverage)
+//rows which are active at a SNP without a support there
+size_t findBiggestAccidentalCoverage(const SupportMatrix& supports, size_t minCoverage)
 {
-	size_t maxSNP = 0;
-	size_t maxRead = 0;
-	for (auto x : supports)
-	{
-		maxSNP = std::max(maxSNP, x.SNPnum);
-		maxRead = std::max(maxRead, x.readNum);
-	}
-	maxSNP++;
-	maxRead++;
-	std::vector<std::pair<size_t, size_t>> rowExtents;
-	rowExtents.resize(maxRead, {-1, 0});
-	std::vector<std::vector<bool>> used;
-	used.resize(maxSNP);
-	for (size_t i = 0; i < used.size(); i++)
-	{
-		used[i].resize(maxRead, false);
-	}
-	for (auto x : supports)
-	{
-		used[x.SNPnum][x.readNum] = true;
-		rowExtents[x.readNum].first = std::min(rowExtents[x.readNum].first, x.SNPnum);
-		rowExtents[x.readNum].second = std::max(rowExtents[x.readNum].second, x.SNPnum);
-	}
+	std::vector<size_t> actives = getActiveCoverage(supports);
+	std::vector<size_t> used = getSupportedCoverage(supports);
 	size_t biggestIndex = 0;
 	size_t biggestCoverage = 0;
-	for (size_t i = 0; i < used.size(); i++)
+	for (size_t i = 0; i < actives.size(); i++)
 	{
-		size_t coverage = 0;
-		for (size_t j = 0; j < used[i].size(); j++)
-		{
-			if (!used[i][j] && rowExtents[j].first < i && rowExtents[j].second > i)
-			{
-				coverage++;
-			}
-		}
+		size_t coverage = actives[i]-used[i];
 		if (coverage > biggestCoverage)
 		{
 			biggestCoverage = coverage;
@@ -55,31 +28,14 @@ size_t findBiggestAccidentalCoverage(std::vector<SNPSupport> supports, size_t mi
 	return -1;
 }
 
-std::vector<SNPLine> filterLines(std::vector<SNPLine> lines, size_t SNPnum)
+//rows with supports on both sides of SNPnum but not at it
+std::vector<SNPLineView> filterLines(const SupportMatrix& supports, size_t SNPnum)
 {
-	std::vector<SNPLine> ret;
-	for (auto x : lines)
+	std::vector<SNPLineView> ret;
+	for (size_t i = 0; i < supports.numReads(); i++)
 	{
-		bool hasLeft = false;
-		bool hasRight = false;
-		for (auto y : x.variantsAtLocations)
-		{
-			if (y.first == SNPnum)
-			{
-				hasRight = false;
-				hasLeft = false;
-				break;
-			}
-			if (y.first < SNPnum)
-			{
-				hasLeft = true;
-			}
-			if (y.first > SNPnum)
-			{
-				hasRight = true;
-			}
-		}
-		if (hasLeft && hasRight)
+		SNPLineView x = supports.row(i);
+		if (x.countBefore(SNPnum) > 0 && x.countAfter(SNPnum) > 0 && !x.has(SNPnum))
 		{
 			ret.push_back(x);
 		}
@@ -87,25 +43,14 @@ std::vector<SNPLine> filterLines(std::vector<SNPLine> lines, size_t SNPnum)
 	return ret;
 }
 
-std::pair<size_t, bool> findEasiestRemovableLine(std::vector<SNPLine> lines, size_t SNPnum)
+std::pair<size_t, bool> findEasiestRemovableLine(const std::vector<SNPLineView>& lines, size_t SNPnum)
 {
 	std::pair<size_t, bool> easiestRemovable { -1, false };
 	size_t easiestRemovableSize = -1;
-	for (auto x : lines)
+	for (const auto& x : lines)
 	{
-		size_t leftSize = 0;
-		size_t rightSize = 0;
-		for (auto y : x.variantsAtLocations)
-		{
-			if (y.first < SNPnum)
-			{
-				leftSize++;
-			}
-			if (y.first > SNPnum)
-			{
-				rightSize++;
-			}
-		}
+		size_t leftSize = x.countBefore(SNPnum);
+		size_t rightSize = x.countAfter(SNPnum);
 		if (leftSize < easiestRemovableSize)
 		{
 			easiestRemovable = std::pair<size_t, bool> { x.readNum, false };
@@ -120,41 +65,42 @@ std::pair<size_t, bool> findEasiestRemovableLine(std::vector<SNPLine> lines, siz
 	return easiestRemovable;
 }
 
-std::vector<SNPSupport> removeOutliers(std::vector<SNPSupport> supports, size_t readNum, size_t SNPnum, bool right)
+SupportMatrix removeOutliers(const SupportMatrix& supports, size_t readNum, size_t SNPnum, bool right)
 {
-	std::vector<SNPSupport> ret;
+	SupportMatrix ret;
+	ret.reserve(supports.size());
 	for (auto x : supports)
 	{
 		if (x.readNum != readNum)
 		{
-			ret.push_back(x);
+			ret.add(x);
 		}
 		else
 		{
 			if (x.SNPnum < SNPnum && right)
 			{
-				ret.push_back(x);
+				ret.add(x);
 			}
 			else if (x.SNPnum > SNPnum && !right)
 			{
-				ret.push_back(x);
+				ret.add(x);
 			}
 		}
 	}
+	ret.index();
 	return ret;
 }
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 	size_t sizeStart = supports.size();
 	size_t limit = std::stol(argv[3]);
 	size_t foundSNP = findBiggestAccidentalCoverage(supports, limit);
 	size_t oldSize = sizeStart;
 	while (foundSNP != -1)
 	{
-		std::vector<SNPLine> lines = makeLines(supports);
-		lines = filterLines(lines, foundSNP);
+		std::vector<SNPLineView> lines = filterLines(supports, foundSNP);
 		std::pair<size_t, bool> easiestRemovable = findEasiestRemovableLine(lines, foundSNP);
 		supports = removeOutliers(supports, easiestRemovable.first, foundSNP, easiestRemovable.second);
 		size_t currentSize = supports.size();
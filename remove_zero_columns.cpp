@@ -7,39 +7,24 @@
 
 int main(int argc, char** argv)
 {
-	std::vector<SNPSupport> supports = loadSupports(argv[1]);
-	std::vector<bool> readUsed;
-	std::vector<bool> SNPused;
-	for (auto x : supports)
-	{
-		if (readUsed.size() <= x.readNum)
-		{
-			readUsed.resize(x.readNum+1, false);
-		}
-		if (SNPused.size() <= x.SNPnum)
-		{
-			SNPused.resize(x.SNPnum+1, false);
-		}
-		readUsed[x.readNum] = true;
-		SNPused[x.SNPnum] = true;
-	}
+	SupportMatrix supports = loadSupportMatrix(argv[1]);
 
-	std::cerr << readUsed.size() << " lines\n";
+	std::cerr << supports.numReads() << " lines\n";
 
 	SupportRenumbering renumbering;
 	size_t usedReads = 0;
-	for (size_t i = 0; i < readUsed.size(); i++)
+	for (size_t i = 0; i < supports.numReads(); i++)
 	{
-		if (readUsed[i])
+		if (supports.readStart(i) < supports.readStart(i+1))
 		{
 			renumbering.addReadRenumbering(i, usedReads);
 			usedReads++;
 		}
 	}
 	size_t usedSNPs = 0;
-	for (size_t i = 0; i < SNPused.size(); i++)
+	for (size_t i = 0; i < supports.numSNPs(); i++)
 	{
-		if (SNPused[i])
+		if (supports.SNPstart(i) < supports.SNPstart(i+1))
 		{
 			renumbering.addSNPRenumbering(i, usedSNPs);
 			usedSNPs++;
@@ -48,7 +33,7 @@ int main(int argc, char** argv)
 
 	std::cerr << "cut to " << usedReads << "\n";
 
-	std::vector<SNPSupport> result = renumberSupports(supports, renumbering);
+	SupportMatrix result = renumberSupports(supports, renumbering);
 	writeSupports(result, argv[2]);
 	writeRenumbering(renumbering, argv[3]);
 }
\ No newline at end of file
@@ -1,20 +1,34 @@
 //g++ renumberer.cpp variant_utils.cpp fasta_utils.cpp -std=c++11 -o renumberer.exe
 //./renumberer.exe outputResultFile inputResultFile inputRenumberingFile1 inputRenumberingFile2 ...
 
+#include <iostream>
+
 #include "variant_utils.h"
 
+//the set of each read, then the score
 std::pair<std::vector<size_t>, size_t> loadResult(std::string fileName)
 {
-	std::ifstream file { fileName };
+	TextFileParser parser { fileName };
+	if (!parser.isOpen())
+	{
+		std::cerr << "can't open result file " << fileName << "\n";
+		std::exit(1);
+	}
 	std::pair<std::vector<size_t>, size_t> result;
-	while (file.good())
+	while (!parser.atEnd())
 	{
 		size_t read;
-		file >> read;
-		if (file.good())
+		if (!parser.parseSize(read))
 		{
-			result.first.push_back(read);
+			std::cerr << fileName << ":" << parser.lineNumber() << ": malformed result, expected a number\n";
+			std::exit(1);
 		}
+		result.first.push_back(read);
+	}
+	if (result.first.size() == 0)
+	{
+		std::cerr << "result file " << fileName << " is empty\n";
+		std::exit(1);
 	}
 	result.second = result.first.back();
 	result.first.pop_back();
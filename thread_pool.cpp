@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t numThreads, std::function<void()> threadStart) :
+	threads(),
+	mutex(),
+	startCondition(),
+	doneCondition(),
+	currentJob(),
+	currentNumJobs(0),
+	nextJob(0),
+	generation(0),
+	workersRunning(0),
+	stopping(false),
+	error()
+{
+	//the calling thread also works, so spawn one less
+	for (size_t i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back([this, threadStart]()
+		{
+			if (threadStart)
+			{
+				threadStart();
+			}
+			workerLoop();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		stopping = true;
+	}
+	startCondition.notify_all();
+	for (auto& x : threads)
+	{
+		x.join();
+	}
+}
+
+size_t ThreadPool::size() const
+{
+	return threads.size()+1;
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		size_t job = nextJob++;
+		if (job >= currentNumJobs)
+		{
+			break;
+		}
+		try
+		{
+			currentJob(job);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+			if (!error)
+			{
+				error = std::current_exception();
+			}
+			nextJob = currentNumJobs;
+		}
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	size_t seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock { mutex };
+			startCondition.wait(lock, [this, seenGeneration]() { return stopping || generation != seenGeneration; });
+			if (stopping)
+			{
+				return;
+			}
+			seenGeneration = generation;
+		}
+		work();
+		{
+			std::lock_guard<std::mutex> lock { mutex };
+			workersRunning--;
+			if (workersRunning == 0)
+			{
+				doneCondition.notify_all();
+			}
+		}
+	}
+}
+
+void ThreadPool::run(size_t numJobs, std::function<void(size_t)> job)
+{
+	if (threads.size() == 0 || numJobs <= 1)
+	{
+		for (size_t i = 0; i < numJobs; i++)
+		{
+			job(i);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock { mutex };
+		currentJob = job;
+		currentNumJobs = numJobs;
+		nextJob = 0;
+		workersRunning = threads.size();
+		generation++;
+	}
+	startCondition.notify_all();
+	work();
+	std::unique_lock<std::mutex> lock { mutex };
+	doneCondition.wait(lock, [this]() { return workersRunning == 0; });
+	currentJob = nullptr;
+	if (error)
+	{
+		std::exception_ptr thrown = error;
+		error = nullptr;
+		std::rethrow_exception(thrown);
+	}
+}
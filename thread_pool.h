@@ -0,0 +1,90 @@
+#ifndef thread_pool_h
+#define thread_pool_h
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+class ThreadPool
+{
+public:
+	//threadStart is called first on each worker thread
+	ThreadPool(size_t numThreads, std::function<void()> threadStart = nullptr);
+	~ThreadPool();
+	ThreadPool(const ThreadPool& second) = delete;
+	ThreadPool& operator=(const ThreadPool& second) = delete;
+	size_t size() const;
+	//calls job(0) ... job(numJobs-1) on the workers and the calling thread, returns when all are done
+	//when a job throws the jobs not started yet are skipped, and the first exception is rethrown here
+	//not reentrant, jobs must not call run themselves
+	void run(size_t numJobs, std::function<void(size_t)> job);
+	//splits [0, count) into consecutive chunks of at least minChunkSize and calls f(start, end) for each
+	template <typename F>
+	void forChunks(size_t count, size_t minChunkSize, F f)
+	{
+		size_t numChunks = count / std::max(minChunkSize, (size_t)1);
+		numChunks = std::min(numChunks, threads.size()+1);
+		if (numChunks <= 1)
+		{
+			if (count > 0)
+			{
+				f((size_t)0, count);
+			}
+			return;
+		}
+		run(numChunks, [count, numChunks, &f](size_t chunk) { f(count*chunk/numChunks, count*(chunk+1)/numChunks); });
+	}
+private:
+	void workerLoop();
+	void work();
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	std::function<void(size_t)> currentJob;
+	size_t currentNumJobs;
+	std::atomic<size_t> nextJob;
+	size_t generation;
+	size_t workersRunning;
+	bool stopping;
+	std::exception_ptr error;
+};
+
+//sorts in chunks on the pool and merges them. comp must be a strict total order for the result to be independent of the number of threads
+template <typename T, typename Compare>
+void parallelSort(std::vector<T>& vec, Compare comp, ThreadPool& pool, size_t minChunkSize)
+{
+	size_t numChunks = std::min(vec.size() / std::max(minChunkSize, (size_t)1), pool.size());
+	if (numChunks <= 1)
+	{
+		std::sort(vec.begin(), vec.end(), comp);
+		return;
+	}
+	std::vector<size_t> bounds;
+	for (size_t i = 0; i <= numChunks; i++)
+	{
+		bounds.push_back(vec.size()*i/numChunks);
+	}
+	pool.run(numChunks, [&vec, &bounds, &comp](size_t chunk) { std::sort(vec.begin()+bounds[chunk], vec.begin()+bounds[chunk+1], comp); });
+	for (size_t width = 1; width < numChunks; width *= 2)
+	{
+		std::vector<size_t> merges;
+		for (size_t i = 0; i+width < numChunks; i += width*2)
+		{
+			merges.push_back(i);
+		}
+		pool.run(merges.size(), [&vec, &bounds, &comp, &merges, width, numChunks](size_t merge)
+		{
+			size_t start = merges[merge];
+			std::inplace_merge(vec.begin()+bounds[start], vec.begin()+bounds[start+width], vec.begin()+bounds[std::min(start+width*2, numChunks)], comp);
+		});
+	}
+}
+
+#endif
@@ -1,6 +1,15 @@
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
 #include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "variant_utils.h"
 
@@ -26,26 +35,840 @@ SNPSupport::SNPSupport(size_t readNum, size_t SNPnum, char variant, double suppo
 {
 }
 
+//"SNPSUPB1", then the version, number of supports, SNPs and reads
+const char binarySupportsMagic[8] = { 'S', 'N', 'P', 'S', 'U', 'P', 'B', '1' };
+const uint64_t binarySupportsVersion = 1;
+const size_t binarySupportsHeaderSize = 40;
+
+//bytes of the arrays after the header. every array starts 8-byte aligned since the 8-byte ones come first
+size_t binarySupportsSize(size_t numSupports, size_t numSNPs)
+{
+	return binarySupportsHeaderSize + (numSNPs+1)*sizeof(uint64_t) + numSupports*(sizeof(double)+2*sizeof(uint32_t)+sizeof(char));
+}
+
+MappedSupportFile::MappedSupportFile(std::string fileName) :
+	mapping(nullptr),
+	mappingSize(0),
+	numSupports(0),
+	SNPcount(0),
+	readCount(0),
+	offsets(nullptr),
+	weights(nullptr),
+	reads(nullptr),
+	SNPs(nullptr),
+	variants(nullptr)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	struct stat info;
+	if (fd == -1 || fstat(fd, &info) != 0)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		throw std::runtime_error { "can't open supports file "+fileName };
+	}
+	mappingSize = info.st_size;
+	if (mappingSize < binarySupportsHeaderSize)
+	{
+		close(fd);
+		throw std::runtime_error { "binary supports file "+fileName+" is truncated" };
+	}
+	mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		throw std::runtime_error { "can't map binary supports file "+fileName };
+	}
+	const char* bytes = (const char*)mapping;
+	const uint64_t* header = (const uint64_t*)bytes;
+	numSupports = header[2];
+	SNPcount = header[3];
+	readCount = header[4];
+	//the counts are checked against the file size first so that the expected size can't overflow
+	if (memcmp(bytes, binarySupportsMagic, sizeof(binarySupportsMagic)) != 0 || header[1] != binarySupportsVersion || numSupports > mappingSize || SNPcount > mappingSize || mappingSize != binarySupportsSize(numSupports, SNPcount))
+	{
+		munmap(mapping, mappingSize);
+		throw std::runtime_error { "binary supports file "+fileName+" is truncated or has an unknown version" };
+	}
+	offsets = (const uint64_t*)(bytes+binarySupportsHeaderSize);
+	weights = (const double*)(offsets+SNPcount+1);
+	reads = (const uint32_t*)(weights+numSupports);
+	SNPs = reads+numSupports;
+	variants = (const char*)(SNPs+numSupports);
+	//every support must be in its SNP's range of the offsets, and its read in the read count
+	bool consistent = offsets[0] == 0 && offsets[SNPcount] == numSupports;
+	for (size_t SNP = 0; SNP < SNPcount && consistent; SNP++)
+	{
+		consistent = offsets[SNP] <= offsets[SNP+1] && offsets[SNP+1] <= numSupports;
+		for (size_t i = offsets[SNP]; i < offsets[SNP+1] && consistent; i++)
+		{
+			consistent = SNPs[i] == SNP && reads[i] < readCount;
+		}
+	}
+	if (!consistent)
+	{
+		munmap(mapping, mappingSize);
+		throw std::runtime_error { "binary supports file "+fileName+" is corrupt" };
+	}
+}
+
+MappedSupportFile::~MappedSupportFile()
+{
+	munmap(mapping, mappingSize);
+}
+
+bool MappedSupportFile::isBinary(std::string fileName)
+{
+	std::ifstream file { fileName, std::ios::binary };
+	char magic[sizeof(binarySupportsMagic)];
+	file.read(magic, sizeof(magic));
+	return file.good() && memcmp(magic, binarySupportsMagic, sizeof(magic)) == 0;
+}
+
+//sorted(i) is the i:th support sorted by SNP and read
+template <typename F>
+void writeBinarySupports(size_t numSupports, size_t numSNPs, size_t numReads, F sorted, std::string fileName)
+{
+	if (numSNPs > UINT32_MAX || numReads > UINT32_MAX)
+	{
+		throw std::overflow_error { "too many reads or SNPs for binary supports file "+fileName };
+	}
+	size_t size = binarySupportsSize(numSupports, numSNPs);
+	int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	void* mapping = MAP_FAILED;
+	if (fd != -1 && ftruncate(fd, size) == 0)
+	{
+		mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if (fd != -1)
+	{
+		close(fd);
+	}
+	if (mapping == MAP_FAILED)
+	{
+		throw std::runtime_error { "can't write binary supports file "+fileName };
+	}
+	char* bytes = (char*)mapping;
+	uint64_t* header = (uint64_t*)bytes;
+	memcpy(bytes, binarySupportsMagic, sizeof(binarySupportsMagic));
+	header[1] = binarySupportsVersion;
+	header[2] = numSupports;
+	header[3] = numSNPs;
+	header[4] = numReads;
+	uint64_t* offsets = (uint64_t*)(bytes+binarySupportsHeaderSize);
+	double* weights = (double*)(offsets+numSNPs+1);
+	uint32_t* reads = (uint32_t*)(weights+numSupports);
+	uint32_t* SNPs = reads+numSupports;
+	char* variants = (char*)(SNPs+numSupports);
+	size_t SNP = 0;
+	for (size_t i = 0; i < numSupports; i++)
+	{
+		SNPSupport x = sorted(i);
+		while (SNP <= x.SNPnum)
+		{
+			offsets[SNP] = i;
+			SNP++;
+		}
+		weights[i] = x.support;
+		reads[i] = x.readNum;
+		SNPs[i] = x.SNPnum;
+		variants[i] = x.variant;
+	}
+	while (SNP <= numSNPs)
+	{
+		offsets[SNP] = numSupports;
+		SNP++;
+	}
+	munmap(mapping, size);
+}
+
+void MappedSupportFile::write(const std::vector<SNPSupport>& supports, std::string fileName)
+{
+	size_t numSNPs = 0;
+	size_t numReads = 0;
+	for (const auto& x : supports)
+	{
+		numSNPs = std::max(numSNPs, x.SNPnum+1);
+		numReads = std::max(numReads, x.readNum+1);
+	}
+	std::vector<size_t> order;
+	order.resize(supports.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&supports](size_t left, size_t right) { return supports[left].SNPnum < supports[right].SNPnum || (supports[left].SNPnum == supports[right].SNPnum && supports[left].readNum < supports[right].readNum); });
+	writeBinarySupports(supports.size(), numSNPs, numReads, [&supports, &order](size_t i) { return supports[order[i]]; }, fileName);
+}
+
+void MappedSupportFile::write(const SupportMatrix& supports, std::string fileName)
+{
+	writeBinarySupports(supports.size(), supports.numSNPs(), supports.numReads(), [&supports](size_t i) { return supports[i]; }, fileName);
+}
+
+size_t MappedSupportFile::size() const
+{
+	return numSupports;
+}
+
+size_t MappedSupportFile::numSNPs() const
+{
+	return SNPcount;
+}
+
+size_t MappedSupportFile::numReads() const
+{
+	return readCount;
+}
+
+SNPSupport MappedSupportFile::operator[](size_t index) const
+{
+	assert(index < numSupports);
+	return SNPSupport { reads[index], SNPs[index], variants[index], weights[index] };
+}
+
+size_t MappedSupportFile::SNPstart(size_t SNP) const
+{
+	assert(SNP <= SNPcount);
+	return offsets[SNP];
+}
+
+//powers of ten which are exact doubles
+const double exactPowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+TextFileParser::TextFileParser(std::string fileName) :
+	file(fileName, std::ios::binary),
+	buffer(),
+	position(0),
+	dataEnd(0),
+	lineEnd(0),
+	line(1),
+	fileEnded(false)
+{
+	buffer.resize((1 << 20) + 1, 0);
+	fillLine();
+}
+
+bool TextFileParser::isOpen() const
+{
+	return file.is_open();
+}
+
+void TextFileParser::fillLine()
+{
+	while (true)
+	{
+		const char* newline = (const char*)memchr(buffer.data()+position, '\n', dataEnd-position);
+		if (newline != nullptr)
+		{
+			lineEnd = newline-buffer.data();
+			return;
+		}
+		if (fileEnded)
+		{
+			lineEnd = dataEnd;
+			return;
+		}
+		std::copy(buffer.begin()+position, buffer.begin()+dataEnd, buffer.begin());
+		dataEnd -= position;
+		position = 0;
+		//a line longer than half of the buffer
+		if (dataEnd*2 > buffer.size())
+		{
+			buffer.resize(buffer.size()*2);
+		}
+		file.read(buffer.data()+dataEnd, buffer.size()-1-dataEnd);
+		size_t got = file.gcount();
+		fileEnded = got == 0 || !file.good();
+		dataEnd += got;
+		buffer[dataEnd] = 0;
+	}
+}
+
+bool TextFileParser::atLineEnd()
+{
+	while (position < lineEnd && (buffer[position] == ' ' || buffer[position] == '\t' || buffer[position] == '\r'))
+	{
+		position++;
+	}
+	return position == lineEnd;
+}
+
+bool TextFileParser::atEnd()
+{
+	while (atLineEnd())
+	{
+		if (!nextLine())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TextFileParser::nextLine()
+{
+	position = lineEnd;
+	if (position == dataEnd)
+	{
+		return false;
+	}
+	position++;
+	line++;
+	fillLine();
+	return true;
+}
+
+size_t TextFileParser::lineNumber() const
+{
+	return line;
+}
+
+bool TextFileParser::atFieldEnd(const char* pos) const
+{
+	return *pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n' || *pos == 0;
+}
+
+bool TextFileParser::parseSize(size_t& value)
+{
+	if (atLineEnd())
+	{
+		return false;
+	}
+	const char* pos = buffer.data()+position;
+	size_t result = 0;
+	const char* start = pos;
+	while (*pos >= '0' && *pos <= '9')
+	{
+		size_t digit = *pos - '0';
+		if (result > (SIZE_MAX - digit) / 10)
+		{
+			return false;
+		}
+		result = result * 10 + digit;
+		pos++;
+	}
+	if (pos == start || !atFieldEnd(pos))
+	{
+		return false;
+	}
+	value = result;
+	position = pos-buffer.data();
+	return true;
+}
+
+bool TextFileParser::parseDouble(double& value)
+{
+	if (atLineEnd())
+	{
+		return false;
+	}
+	const char* start = buffer.data()+position;
+	const char* pos = start;
+	bool negative = *pos == '-';
+	if (*pos == '-' || *pos == '+')
+	{
+		pos++;
+	}
+	//digits[.digits] with at most 15 digits is exact as an integer over a power of ten, so dividing them rounds correctly
+	uint64_t mantissa = 0;
+	size_t digits = 0;
+	size_t fractionDigits = 0;
+	while (*pos >= '0' && *pos <= '9')
+	{
+		mantissa = mantissa * 10 + (*pos - '0');
+		digits++;
+		pos++;
+	}
+	if (*pos == '.')
+	{
+		pos++;
+		while (*pos >= '0' && *pos <= '9')
+		{
+			mantissa = mantissa * 10 + (*pos - '0');
+			digits++;
+			fractionDigits++;
+			pos++;
+		}
+	}
+	if (digits > 0 && digits <= 15 && atFieldEnd(pos))
+	{
+		value = (double)mantissa / exactPowersOfTen[fractionDigits];
+		if (negative)
+		{
+			value = -value;
+		}
+		position = pos-buffer.data();
+		return true;
+	}
+	//exponents and long mantissas
+	char* end;
+	double result = strtod(start, &end);
+	if (end == start || !atFieldEnd(end))
+	{
+		return false;
+	}
+	value = result;
+	position = end-buffer.data();
+	return true;
+}
+
+bool TextFileParser::parseChar(char& value)
+{
+	if (atLineEnd())
+	{
+		return false;
+	}
+	if (!atFieldEnd(buffer.data()+position+1))
+	{
+		return false;
+	}
+	value = buffer[position];
+	position++;
+	return true;
+}
+
+size_t TextFileParser::countLines(std::string fileName)
+{
+	std::ifstream file { fileName, std::ios::binary };
+	std::vector<char> block;
+	block.resize(1 << 20);
+	size_t result = 0;
+	char last = '\n';
+	while (file.good())
+	{
+		file.read(block.data(), block.size());
+		size_t got = file.gcount();
+		if (got == 0)
+		{
+			break;
+		}
+		result += std::count(block.begin(), block.begin()+got, '\n');
+		last = block[got-1];
+	}
+	if (last != '\n')
+	{
+		result++;
+	}
+	return result;
+}
+
+SupportFileReader::SupportFileReader(std::string fileName) :
+	fileName(fileName),
+	parser(),
+	malformedLines(0),
+	mapped(),
+	position(0)
+{
+	if (MappedSupportFile::isBinary(fileName))
+	{
+		mapped.reset(new MappedSupportFile { fileName });
+		return;
+	}
+	parser.reset(new TextFileParser { fileName });
+	if (!parser->isOpen())
+	{
+		throw std::runtime_error { "can't open supports file "+fileName };
+	}
+}
+
+bool SupportFileReader::next(SNPSupport& support)
+{
+	if (mapped)
+	{
+		if (position == mapped->size())
+		{
+			return false;
+		}
+		support = (*mapped)[position];
+		position++;
+		return true;
+	}
+	//lines are "readNum SNPnum variant support", empty lines are skipped
+	while (!parser->atEnd())
+	{
+		size_t readNum, SNPnum;
+		char variant;
+		double value;
+		bool parsed = parser->parseSize(readNum) && parser->parseSize(SNPnum) && parser->parseChar(variant) && parser->parseDouble(value) && parser->atLineEnd();
+		size_t line = parser->lineNumber();
+		parser->nextLine();
+		if (parsed)
+		{
+			support = SNPSupport { readNum, SNPnum, variant, value };
+			return true;
+		}
+		malformedLines++;
+		if (malformedLines <= 10)
+		{
+			std::cerr << fileName << ":" << line << ": malformed support, expected \"readNum SNPnum variant support\"\n";
+		}
+	}
+	if (malformedLines > 0)
+	{
+		throw std::runtime_error { std::to_string(malformedLines)+" malformed lines in supports file "+fileName };
+	}
+	return false;
+}
+
 std::vector<SNPSupport> loadSupports(std::string fileName)
 {
-	std::vector<SNPSupport> result;
-	std::ifstream file { fileName };
-	do
+	std::vector<SNPSupport> result;
+	if (MappedSupportFile::isBinary(fileName))
+	{
+		MappedSupportFile mapped { fileName };
+		result.reserve(mapped.size());
+		for (size_t i = 0; i < mapped.size(); i++)
+		{
+			result.push_back(mapped[i]);
+		}
+		return result;
+	}
+	result.reserve(TextFileParser::countLines(fileName));
+	SupportFileReader reader { fileName };
+	SNPSupport support { 0, 0, 'A', 0 };
+	while (reader.next(support))
+	{
+		result.push_back(support);
+	}
+	return result;
+}
+
+SupportMatrix loadSupportMatrix(std::string fileName)
+{
+	SupportMatrix result;
+	if (MappedSupportFile::isBinary(fileName))
+	{
+		result.reserve(MappedSupportFile { fileName }.size());
+	}
+	else
+	{
+		result.reserve(TextFileParser::countLines(fileName));
+	}
+	SupportFileReader reader { fileName };
+	SNPSupport support { 0, 0, 'A', 0 };
+	while (reader.next(support))
+	{
+		result.add(support);
+	}
+	result.index();
+	return result;
+}
+
+SupportMatrix::const_iterator::const_iterator(const SupportMatrix& matrix, size_t index) :
+	matrix(&matrix),
+	index(index)
+{
+}
+
+SNPSupport SupportMatrix::const_iterator::operator*() const
+{
+	return (*matrix)[index];
+}
+
+SupportMatrix::const_iterator& SupportMatrix::const_iterator::operator++()
+{
+	index++;
+	return *this;
+}
+
+SupportMatrix::const_iterator SupportMatrix::const_iterator::operator++(int)
+{
+	const_iterator ret = *this;
+	index++;
+	return ret;
+}
+
+bool SupportMatrix::const_iterator::operator==(const const_iterator& second) const
+{
+	return matrix == second.matrix && index == second.index;
+}
+
+bool SupportMatrix::const_iterator::operator!=(const const_iterator& second) const
+{
+	return !(*this == second);
+}
+
+SupportMatrix::SupportMatrix() :
+	reads(),
+	SNPs(),
+	variantCodes(),
+	otherVariants(),
+	weights(),
+	SNPstarts(),
+	readStarts(),
+	readOrder(),
+	readCount(0),
+	indexed(false)
+{
+}
+
+SupportMatrix::SupportMatrix(const std::vector<SNPSupport>& supports) :
+	SupportMatrix()
+{
+	reserve(supports.size());
+	for (const auto& x : supports)
+	{
+		add(x);
+	}
+	index();
+}
+
+void SupportMatrix::reserve(size_t numSupports)
+{
+	reads.reserve(numSupports);
+	SNPs.reserve(numSupports);
+	weights.reserve(numSupports);
+	variantCodes.reserve((numSupports+3)/4);
+}
+
+void SupportMatrix::setVariant(size_t index, char variant)
+{
+	size_t code = 0;
+	switch(variant)
+	{
+		case 'A':
+			code = 0;
+			break;
+		case 'C':
+			code = 1;
+			break;
+		case 'G':
+			code = 2;
+			break;
+		case 'T':
+			code = 3;
+			break;
+		default:
+			otherVariants.emplace_back(index, variant);
+			break;
+	}
+	if (variantCodes.size() <= index/4)
+	{
+		variantCodes.resize(index/4+1, 0);
+	}
+	variantCodes[index/4] &= ~(3 << (index%4*2));
+	variantCodes[index/4] |= code << (index%4*2);
+}
+
+void SupportMatrix::add(const SNPSupport& support)
+{
+	if (support.readNum >= UINT32_MAX || support.SNPnum >= UINT32_MAX || reads.size() >= UINT32_MAX)
+	{
+		throw std::overflow_error { "support "+std::to_string(support.readNum)+" "+std::to_string(support.SNPnum)+" doesn't fit in a support matrix, reads, SNPs and supports are limited to 32 bits" };
+	}
+	indexed = false;
+	setVariant(reads.size(), support.variant);
+	reads.push_back(support.readNum);
+	SNPs.push_back(support.SNPnum);
+	weights.push_back(support.support);
+}
+
+void SupportMatrix::index()
+{
+	size_t numSupports = reads.size();
+	bool sorted = true;
+	for (size_t i = 1; i < numSupports && sorted; i++)
+	{
+		sorted = SNPs[i-1] < SNPs[i] || (SNPs[i-1] == SNPs[i] && reads[i-1] <= reads[i]);
+	}
+	if (!sorted)
+	{
+		std::vector<uint32_t> order;
+		order.resize(numSupports);
+		for (size_t i = 0; i < numSupports; i++)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t left, uint32_t right) { return SNPs[left] < SNPs[right] || (SNPs[left] == SNPs[right] && reads[left] < reads[right]); });
+		std::vector<uint32_t> oldReads = std::move(reads);
+		std::vector<uint32_t> oldSNPs = std::move(SNPs);
+		std::vector<double> oldWeights = std::move(weights);
+		std::vector<uint8_t> oldCodes = std::move(variantCodes);
+		std::vector<std::pair<uint32_t, char>> oldOthers = std::move(otherVariants);
+		std::sort(oldOthers.begin(), oldOthers.end());
+		reads.resize(numSupports);
+		SNPs.resize(numSupports);
+		weights.resize(numSupports);
+		variantCodes.clear();
+		variantCodes.resize((numSupports+3)/4, 0);
+		otherVariants.clear();
+		for (size_t i = 0; i < numSupports; i++)
+		{
+			size_t from = order[i];
+			reads[i] = oldReads[from];
+			SNPs[i] = oldSNPs[from];
+			weights[i] = oldWeights[from];
+			auto other = std::lower_bound(oldOthers.begin(), oldOthers.end(), std::make_pair((uint32_t)from, (char)0));
+			if (other != oldOthers.end() && other->first == from)
+			{
+				otherVariants.emplace_back(i, other->second);
+			}
+			else
+			{
+				variantCodes[i/4] |= ((oldCodes[from/4] >> (from%4*2)) & 3) << (i%4*2);
+			}
+		}
+	}
+	size_t SNPcount = numSupports == 0 ? 0 : SNPs.back()+1;
+	readCount = 0;
+	for (auto read : reads)
+	{
+		readCount = std::max(readCount, (size_t)read+1);
+	}
+	SNPstarts.assign(SNPcount+1, 0);
+	readStarts.assign(readCount+1, 0);
+	for (size_t i = 0; i < numSupports; i++)
+	{
+		SNPstarts[SNPs[i]+1]++;
+		readStarts[reads[i]+1]++;
+	}
+	for (size_t i = 1; i < SNPstarts.size(); i++)
+	{
+		SNPstarts[i] += SNPstarts[i-1];
+	}
+	for (size_t i = 1; i < readStarts.size(); i++)
+	{
+		readStarts[i] += readStarts[i-1];
+	}
+	//the supports are by SNP, so each read's supports are placed by SNP
+	readOrder.resize(numSupports);
+	std::vector<size_t> next { readStarts.begin(), readStarts.end()-1 };
+	for (size_t i = 0; i < numSupports; i++)
+	{
+		readOrder[next[reads[i]]] = i;
+		next[reads[i]]++;
+	}
+	indexed = true;
+}
+
+size_t SupportMatrix::size() const
+{
+	return reads.size();
+}
+
+size_t SupportMatrix::numSNPs() const
+{
+	assert(indexed);
+	return SNPstarts.size()-1;
+}
+
+size_t SupportMatrix::numReads() const
+{
+	assert(indexed);
+	return readCount;
+}
+
+size_t SupportMatrix::read(size_t index) const
+{
+	assert(indexed);
+	return reads[index];
+}
+
+size_t SupportMatrix::SNP(size_t index) const
+{
+	assert(indexed);
+	return SNPs[index];
+}
+
+char SupportMatrix::variant(size_t index) const
+{
+	assert(indexed);
+	if (otherVariants.size() > 0)
 	{
-		size_t readNum, SNPnum;
-		char variant;
-		double support;
-		file >> readNum >> SNPnum >> variant >> support;
-		if (file.good())
+		auto other = std::lower_bound(otherVariants.begin(), otherVariants.end(), std::make_pair((uint32_t)index, (char)0));
+		if (other != otherVariants.end() && other->first == index)
 		{
-			result.emplace_back(readNum, SNPnum, variant, support);
+			return other->second;
 		}
-	} while (file.good());
+	}
+	return "ACGT"[(variantCodes[index/4] >> (index%4*2)) & 3];
+}
+
+double SupportMatrix::weight(size_t index) const
+{
+	assert(indexed);
+	return weights[index];
+}
+
+SNPSupport SupportMatrix::operator[](size_t index) const
+{
+	return SNPSupport { read(index), SNP(index), variant(index), weight(index) };
+}
+
+SupportMatrix::const_iterator SupportMatrix::begin() const
+{
+	assert(indexed);
+	return const_iterator { *this, 0 };
+}
+
+SupportMatrix::const_iterator SupportMatrix::end() const
+{
+	assert(indexed);
+	return const_iterator { *this, size() };
+}
+
+size_t SupportMatrix::SNPstart(size_t SNP) const
+{
+	assert(indexed);
+	assert(SNP < SNPstarts.size());
+	return SNPstarts[SNP];
+}
+
+size_t SupportMatrix::readStart(size_t read) const
+{
+	assert(indexed);
+	assert(read < readStarts.size());
+	return readStarts[read];
+}
+
+size_t SupportMatrix::readIndex(size_t position) const
+{
+	assert(indexed);
+	return readOrder[position];
+}
+
+SNPLineView SupportMatrix::row(size_t read) const
+{
+	assert(indexed);
+	return SNPLineView { *this, read };
+}
+
+std::vector<SNPSupport> SupportMatrix::toSupports() const
+{
+	std::vector<SNPSupport> result;
+	result.reserve(size());
+	for (auto x : *this)
+	{
+		result.push_back(x);
+	}
 	return result;
 }
 
+size_t SupportMatrix::bytes() const
+{
+	return reads.capacity()*sizeof(uint32_t) + SNPs.capacity()*sizeof(uint32_t) + variantCodes.capacity() + otherVariants.capacity()*sizeof(std::pair<uint32_t, char>) + weights.capacity()*sizeof(double) + SNPstarts.capacity()*sizeof(size_t) + readStarts.capacity()*sizeof(size_t) + readOrder.capacity()*sizeof(uint32_t);
+}
+
 void writeSupports(std::vector<SNPSupport> supports, std::string fileName)
 {
+	if (fileName.size() >= 4 && fileName.substr(fileName.size()-4) == ".bin")
+	{
+		MappedSupportFile::write(supports, fileName);
+		return;
+	}
+	std::ofstream file { fileName };
+	for (auto x : supports)
+	{
+		file << x.readNum << " " << x.SNPnum << " " << x.variant << " " << x.support << "\n";
+	}
+}
+
+void writeSupports(const SupportMatrix& supports, std::string fileName)
+{
+	if (fileName.size() >= 4 && fileName.substr(fileName.size()-4) == ".bin")
+	{
+		MappedSupportFile::write(supports, fileName);
+		return;
+	}
 	std::ofstream file { fileName };
 	for (auto x : supports)
 	{
@@ -128,6 +951,20 @@ bool SupportRenumbering::checkValidity() const
 	return true;
 }
 
+SupportMatrix renumberSupports(const SupportMatrix& supports, const SupportRenumbering& renumbering)
+{
+	SupportMatrix ret;
+	ret.reserve(supports.size());
+	for (auto x : supports)
+	{
+		x.readNum = renumbering.getReadRenumbering(x.readNum);
+		x.SNPnum = renumbering.getSNPRenumbering(x.SNPnum);
+		ret.add(x);
+	}
+	ret.index();
+	return ret;
+}
+
 std::vector<SNPSupport> renumberSupports(std::vector<SNPSupport> supports, SupportRenumbering renumbering)
 {
 	std::vector<SNPSupport> ret;
@@ -340,27 +1177,36 @@ void writeRenumbering(SupportRenumbering renumbering, std::string fileName)
 	file << "\n";
 }
 
+//the number of reads and their new positions, then the number of SNPs and theirs
 SupportRenumbering loadRenumbering(std::string fileName)
 {
 	SupportRenumbering ret;
-	std::ifstream file { fileName };
-	size_t reads;
-	file >> reads;
+	TextFileParser parser { fileName };
+	if (!parser.isOpen())
+	{
+		throw std::runtime_error { "can't open renumbering file "+fileName };
+	}
+	auto next = [&parser, &fileName]()
+	{
+		size_t value;
+		if (parser.atEnd() || !parser.parseSize(value))
+		{
+			throw std::runtime_error { fileName+":"+std::to_string(parser.lineNumber())+": malformed renumbering, expected a number" };
+		}
+		return value;
+	};
+	size_t reads = next();
+	ret.readRenumbering.reserve(reads);
 	for (size_t i = 0; i < reads; i++)
 	{
-		size_t readPos;
-		file >> readPos;
-		ret.addReadRenumbering(i, readPos);
+		ret.addReadRenumbering(i, next());
 	}
-	size_t SNPs;
-	file >> SNPs;
+	size_t SNPs = next();
+	ret.SNPRenumbering.reserve(SNPs);
 	for (size_t i = 0; i < SNPs; i++)
 	{
-		size_t SNPpos;
-		file >> SNPpos;
-		ret.addSNPRenumbering(i, SNPpos);
+		ret.addSNPRenumbering(i, next());
 	}
-	assert(file.good());
 	return ret;
 }
 
@@ -480,16 +1326,122 @@ char SNPLine::variantAt(size_t loc) const
 
 std::vector<SNPLine> makeLines(std::vector<SNPSupport> supports)
 {
-	std::sort(supports.begin(), supports.end(), [](SNPSupport left, SNPSupport right) { return left.SNPnum < right.SNPnum; });
-	std::set<size_t> reads;
-	for (auto x : supports)
+	std::stable_sort(supports.begin(), supports.end(), [](const SNPSupport& left, const SNPSupport& right) { return left.readNum < right.readNum || (left.readNum == right.readNum && left.SNPnum < right.SNPnum); });
+	std::vector<SNPLine> result;
+	for (size_t i = 0; i < supports.size(); i++)
 	{
-		reads.insert(x.readNum);
+		if (i == 0 || supports[i].readNum != supports[i-1].readNum)
+		{
+			result.emplace_back();
+			result.back().readNum = supports[i].readNum;
+		}
+		result.back().variantsAtLocations.emplace_back(supports[i].SNPnum, supports[i].variant);
+		result.back().supportsAtLocations.push_back(supports[i].support);
 	}
+	return result;
+}
+
+std::vector<SNPLine> makeLines(const SupportMatrix& supports)
+{
 	std::vector<SNPLine> result;
-	for (auto x : reads)
+	for (size_t i = 0; i < supports.numReads(); i++)
+	{
+		if (supports.readStart(i) < supports.readStart(i+1))
+		{
+			result.push_back(supports.row(i).toLine());
+		}
+	}
+	return result;
+}
+
+SNPLineView::SNPLineView(const SupportMatrix& matrix, size_t readNum) :
+	readNum(readNum),
+	matrix(&matrix),
+	start(matrix.readStart(readNum)),
+	end(matrix.readStart(readNum+1))
+{
+}
+
+size_t SNPLineView::size() const
+{
+	return end-start;
+}
+
+size_t SNPLineView::SNP(size_t index) const
+{
+	assert(index < size());
+	return matrix->SNP(matrix->readIndex(start+index));
+}
+
+char SNPLineView::variant(size_t index) const
+{
+	assert(index < size());
+	return matrix->variant(matrix->readIndex(start+index));
+}
+
+double SNPLineView::support(size_t index) const
+{
+	assert(index < size());
+	return matrix->weight(matrix->readIndex(start+index));
+}
+
+size_t SNPLineView::lowerBound(size_t loc) const
+{
+	size_t low = 0;
+	size_t high = size();
+	while (low < high)
+	{
+		size_t mid = (low+high)/2;
+		if (SNP(mid) < loc)
+		{
+			low = mid+1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+bool SNPLineView::has(size_t loc) const
+{
+	size_t index = lowerBound(loc);
+	return index < size() && SNP(index) == loc;
+}
+
+char SNPLineView::variantAt(size_t loc) const
+{
+	assert(has(loc));
+	return variant(lowerBound(loc));
+}
+
+double SNPLineView::supportAt(size_t loc) const
+{
+	assert(has(loc));
+	return support(lowerBound(loc));
+}
+
+size_t SNPLineView::countBefore(size_t loc) const
+{
+	return lowerBound(loc);
+}
+
+size_t SNPLineView::countAfter(size_t loc) const
+{
+	return size()-lowerBound(loc+1);
+}
+
+SNPLine SNPLineView::toLine() const
+{
+	SNPLine result;
+	result.readNum = readNum;
+	result.variantsAtLocations.reserve(size());
+	result.supportsAtLocations.reserve(size());
+	for (size_t i = 0; i < size(); i++)
 	{
-		result.emplace_back(supports.begin(), supports.end(), x);
+		result.variantsAtLocations.emplace_back(SNP(i), variant(i));
+		result.supportsAtLocations.push_back(support(i));
 	}
 	return result;
 }
@@ -577,3 +1529,255 @@ std::vector<SNPSupport> mergeRowsForceMerge(std::vector<SNPSupport> oldSupports,
 	}
 	return result;
 }
+
+std::vector<std::pair<size_t, size_t>> getRowExtents(const SupportMatrix& supports)
+{
+	std::vector<std::pair<size_t, size_t>> rowExtents;
+	rowExtents.resize(supports.numReads(), {-1, 0});
+	for (size_t i = 0; i < supports.numReads(); i++)
+	{
+		if (supports.readStart(i) < supports.readStart(i+1))
+		{
+			rowExtents[i].first = supports.SNP(supports.readIndex(supports.readStart(i)));
+			rowExtents[i].second = supports.SNP(supports.readIndex(supports.readStart(i+1)-1));
+		}
+	}
+	return rowExtents;
+}
+
+std::vector<std::pair<size_t, size_t>> getRowExtents(const std::vector<SNPSupport>& supports)
+{
+	size_t maxRead = 0;
+	for (const auto& x : supports)
+	{
+		maxRead = std::max(maxRead, x.readNum+1);
+	}
+	std::vector<std::pair<size_t, size_t>> rowExtents;
+	rowExtents.resize(maxRead, {-1, 0});
+	for (const auto& x : supports)
+	{
+		rowExtents[x.readNum].first = std::min(rowExtents[x.readNum].first, x.SNPnum);
+		rowExtents[x.readNum].second = std::max(rowExtents[x.readNum].second, x.SNPnum);
+	}
+	return rowExtents;
+}
+
+ActiveRowSweep::ActiveRowSweep(const std::vector<std::pair<size_t, size_t>>& rowExtents, size_t numSNPs, bool trackRows) :
+	startRows(),
+	startOffsets(),
+	endRows(),
+	endOffsets(),
+	active(),
+	currentSNP(-1),
+	SNPcount(numSNPs),
+	currentCoverage(0),
+	trackRows(trackRows)
+{
+	init(rowExtents);
+}
+
+ActiveRowSweep::ActiveRowSweep(const std::vector<SNPSupport>& supports, bool trackRows) :
+	startRows(),
+	startOffsets(),
+	endRows(),
+	endOffsets(),
+	active(),
+	currentSNP(-1),
+	SNPcount(0),
+	currentCoverage(0),
+	trackRows(trackRows)
+{
+	for (const auto& x : supports)
+	{
+		SNPcount = std::max(SNPcount, x.SNPnum+1);
+	}
+	init(getRowExtents(supports));
+}
+
+ActiveRowSweep::ActiveRowSweep(const SupportMatrix& supports, bool trackRows) :
+	startRows(),
+	startOffsets(),
+	endRows(),
+	endOffsets(),
+	active(),
+	currentSNP(-1),
+	SNPcount(supports.numSNPs()),
+	currentCoverage(0),
+	trackRows(trackRows)
+{
+	init(getRowExtents(supports));
+}
+
+void ActiveRowSweep::init(const std::vector<std::pair<size_t, size_t>>& rowExtents)
+{
+	std::vector<std::pair<size_t, size_t>> starts;
+	std::vector<std::pair<size_t, size_t>> ends;
+	for (size_t i = 0; i < rowExtents.size(); i++)
+	{
+		if (rowExtents[i].first > rowExtents[i].second)
+		{
+			continue;
+		}
+		assert(rowExtents[i].second < SNPcount);
+		starts.emplace_back(rowExtents[i].first, i);
+		ends.emplace_back(rowExtents[i].second, i);
+	}
+	std::sort(starts.begin(), starts.end());
+	std::sort(ends.begin(), ends.end());
+	startOffsets.resize(SNPcount+1, 0);
+	endOffsets.resize(SNPcount+1, 0);
+	for (const auto& x : starts)
+	{
+		startRows.push_back(x.second);
+		startOffsets[x.first+1]++;
+	}
+	for (const auto& x : ends)
+	{
+		endRows.push_back(x.second);
+		endOffsets[x.first+1]++;
+	}
+	for (size_t i = 1; i <= SNPcount; i++)
+	{
+		startOffsets[i] += startOffsets[i-1];
+		endOffsets[i] += endOffsets[i-1];
+	}
+}
+
+bool ActiveRowSweep::next()
+{
+	if (currentSNP != -1 && currentSNP >= SNPcount)
+	{
+		return false;
+	}
+	if (currentSNP != -1)
+	{
+		currentCoverage -= endOffsets[currentSNP+1]-endOffsets[currentSNP];
+		if (trackRows && endOffsets[currentSNP+1] > endOffsets[currentSNP])
+		{
+			std::vector<uint32_t> remaining;
+			remaining.reserve(active.size());
+			std::set_difference(active.begin(), active.end(), endingBegin(), endingEnd(), std::back_inserter(remaining));
+			active = std::move(remaining);
+		}
+	}
+	currentSNP++;
+	if (currentSNP >= SNPcount)
+	{
+		return false;
+	}
+	currentCoverage += startOffsets[currentSNP+1]-startOffsets[currentSNP];
+	if (trackRows && startOffsets[currentSNP+1] > startOffsets[currentSNP])
+	{
+		std::vector<uint32_t> merged;
+		merged.reserve(currentCoverage);
+		std::merge(active.begin(), active.end(), startingBegin(), startingEnd(), std::back_inserter(merged));
+		active = std::move(merged);
+	}
+	assert(!trackRows || active.size() == currentCoverage);
+	return true;
+}
+
+size_t ActiveRowSweep::SNP() const
+{
+	return currentSNP;
+}
+
+size_t ActiveRowSweep::numSNPs() const
+{
+	return SNPcount;
+}
+
+size_t ActiveRowSweep::coverage() const
+{
+	return currentCoverage;
+}
+
+std::vector<size_t>::const_iterator ActiveRowSweep::startingBegin() const
+{
+	assert(currentSNP < SNPcount);
+	return startRows.begin()+startOffsets[currentSNP];
+}
+
+std::vector<size_t>::const_iterator ActiveRowSweep::startingEnd() const
+{
+	assert(currentSNP < SNPcount);
+	return startRows.begin()+startOffsets[currentSNP+1];
+}
+
+std::vector<size_t>::const_iterator ActiveRowSweep::endingBegin() const
+{
+	assert(currentSNP < SNPcount);
+	return endRows.begin()+endOffsets[currentSNP];
+}
+
+std::vector<size_t>::const_iterator ActiveRowSweep::endingEnd() const
+{
+	assert(currentSNP < SNPcount);
+	return endRows.begin()+endOffsets[currentSNP+1];
+}
+
+const std::vector<uint32_t>& ActiveRowSweep::activeRows() const
+{
+	assert(trackRows);
+	return active;
+}
+
+std::vector<size_t> getActiveCoverage(const std::vector<SNPSupport>& supports)
+{
+	ActiveRowSweep sweep { supports, false };
+	std::vector<size_t> ret;
+	ret.reserve(sweep.numSNPs());
+	while (sweep.next())
+	{
+		ret.push_back(sweep.coverage());
+	}
+	return ret;
+}
+
+std::vector<size_t> getActiveCoverage(const SupportMatrix& supports)
+{
+	ActiveRowSweep sweep { supports, false };
+	std::vector<size_t> ret;
+	ret.reserve(sweep.numSNPs());
+	while (sweep.next())
+	{
+		ret.push_back(sweep.coverage());
+	}
+	return ret;
+}
+
+std::vector<size_t> getSupportedCoverage(const SupportMatrix& supports)
+{
+	std::vector<size_t> ret;
+	ret.resize(supports.numSNPs(), 0);
+	for (size_t i = 0; i < supports.size(); i++)
+	{
+		//a SNP's supports are by read, so repeated reads are next to each other
+		if (i == supports.SNPstart(supports.SNP(i)) || supports.read(i) != supports.read(i-1))
+		{
+			ret[supports.SNP(i)]++;
+		}
+	}
+	return ret;
+}
+
+std::vector<size_t> getSupportedCoverage(const std::vector<SNPSupport>& supports)
+{
+	std::vector<std::pair<size_t, size_t>> used;
+	used.reserve(supports.size());
+	size_t maxSNP = 0;
+	for (const auto& x : supports)
+	{
+		used.emplace_back(x.SNPnum, x.readNum);
+		maxSNP = std::max(maxSNP, x.SNPnum+1);
+	}
+	std::sort(used.begin(), used.end());
+	used.erase(std::unique(used.begin(), used.end()), used.end());
+	std::vector<size_t> ret;
+	ret.resize(maxSNP, 0);
+	for (const auto& x : used)
+	{
+		ret[x.first]++;
+	}
+	return ret;
+}
@@ -2,8 +2,14 @@
 #define variant_utils_h
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "fasta_utils.h"
 
@@ -54,9 +60,165 @@ public:
 	char variant;
 };
 
+class SupportMatrix;
+class SNPLineView;
+
+//binary supports file: a header, the offset of each SNP's first support, and the supports sorted by SNP and read as separate arrays
+//of weights, reads, SNPs and variants, in the machine's byte order. mapped into memory instead of parsed
+//writeSupports writes it when the file name ends in .bin, and every reader of supports files recognizes it by its magic number
+class MappedSupportFile
+{
+public:
+	//throws std::runtime_error if the file isn't a complete and consistent binary supports file
+	MappedSupportFile(std::string fileName);
+	~MappedSupportFile();
+	MappedSupportFile(const MappedSupportFile& second) = delete;
+	MappedSupportFile& operator=(const MappedSupportFile& second) = delete;
+	static bool isBinary(std::string fileName);
+	static void write(const std::vector<SNPSupport>& supports, std::string fileName);
+	static void write(const SupportMatrix& supports, std::string fileName);
+	size_t size() const;
+	size_t numSNPs() const;
+	size_t numReads() const;
+	SNPSupport operator[](size_t index) const;
+	//the supports of SNP are [SNPstart(SNP), SNPstart(SNP+1))
+	size_t SNPstart(size_t SNP) const;
+private:
+	void* mapping;
+	size_t mappingSize;
+	size_t numSupports;
+	size_t SNPcount;
+	size_t readCount;
+	const uint64_t* offsets;
+	const double* weights;
+	const uint32_t* reads;
+	const uint32_t* SNPs;
+	const char* variants;
+};
+
+//reads a text file in large blocks and parses the fields of its lines without iostreams. the current line is always whole in the buffer
+class TextFileParser
+{
+public:
+	TextFileParser(std::string fileName);
+	bool isOpen() const;
+	//skips spaces on the current line, returns true if nothing else is left on it
+	bool atLineEnd();
+	//skips whitespace over lines, returns true at the end of the file
+	bool atEnd();
+	//moves to the start of the next line, returns false at the end of the file
+	bool nextLine();
+	//parse the next field of the current line. return false without moving if it isn't one
+	bool parseSize(size_t& value);
+	bool parseDouble(double& value);
+	bool parseChar(char& value);
+	//of the current line, from 1
+	size_t lineNumber() const;
+	static size_t countLines(std::string fileName);
+private:
+	void fillLine();
+	bool atFieldEnd(const char* pos) const;
+	std::ifstream file;
+	//the unparsed data is [position, dataEnd), followed by a 0
+	std::vector<char> buffer;
+	size_t position;
+	size_t dataEnd;
+	//the newline of the current line, or dataEnd
+	size_t lineEnd;
+	size_t line;
+	bool fileEnded;
+};
+
+//reads a supports file one support at a time
+//throws std::runtime_error at the end of a text file which has malformed lines, after listing the first ones with their line numbers
+class SupportFileReader
+{
+public:
+	SupportFileReader(std::string fileName);
+	//returns false at the end of the file
+	bool next(SNPSupport& support);
+private:
+	std::string fileName;
+	std::unique_ptr<TextFileParser> parser;
+	size_t malformedLines;
+	//instead of parser for binary supports files
+	std::unique_ptr<MappedSupportFile> mapped;
+	size_t position;
+};
+
+//the supports as separate arrays sorted by SNP and read, with 32-bit reads and SNPs, variants in 2 bits and double weights
+//variants other than A, C, G and T are kept on the side. the supports of a SNP are a range of indices, and so are the positions
+//of a read's supports in the read index. supports are added in any order and index sorts them, nothing else works before it
+class SupportMatrix
+{
+public:
+	class const_iterator
+	{
+	public:
+		typedef std::ptrdiff_t difference_type;
+		typedef SNPSupport value_type;
+		typedef SNPSupport reference;
+		typedef const SNPSupport* pointer;
+		typedef std::forward_iterator_tag iterator_category;
+		const_iterator(const SupportMatrix& matrix, size_t index);
+		SNPSupport operator*() const;
+		const_iterator& operator++();
+		const_iterator operator++(int);
+		bool operator==(const const_iterator& second) const;
+		bool operator!=(const const_iterator& second) const;
+	private:
+		const SupportMatrix* matrix;
+		size_t index;
+	};
+	SupportMatrix();
+	//not explicit, so the functions taking a matrix still take the supports vectors of older callers
+	SupportMatrix(const std::vector<SNPSupport>& supports);
+	//throws std::overflow_error if the read or SNP doesn't fit in 32 bits
+	void add(const SNPSupport& support);
+	void reserve(size_t numSupports);
+	void index();
+	size_t size() const;
+	size_t numSNPs() const;
+	size_t numReads() const;
+	size_t read(size_t index) const;
+	size_t SNP(size_t index) const;
+	char variant(size_t index) const;
+	double weight(size_t index) const;
+	SNPSupport operator[](size_t index) const;
+	const_iterator begin() const;
+	const_iterator end() const;
+	//the supports of SNP are [SNPstart(SNP), SNPstart(SNP+1))
+	size_t SNPstart(size_t SNP) const;
+	//the supports of read are readIndex(i) for i in [readStart(read), readStart(read+1)), by SNP
+	size_t readStart(size_t read) const;
+	size_t readIndex(size_t position) const;
+	SNPLineView row(size_t read) const;
+	std::vector<SNPSupport> toSupports() const;
+	size_t bytes() const;
+private:
+	void setVariant(size_t index, char variant);
+	std::vector<uint32_t> reads;
+	std::vector<uint32_t> SNPs;
+	//four per byte, A C G T
+	std::vector<uint8_t> variantCodes;
+	//index and variant of the supports with other variants, sorted by index
+	std::vector<std::pair<uint32_t, char>> otherVariants;
+	std::vector<double> weights;
+	std::vector<size_t> SNPstarts;
+	std::vector<size_t> readStarts;
+	std::vector<uint32_t> readOrder;
+	size_t readCount;
+	bool indexed;
+};
+
 std::vector<SNPSupport> loadSupports(std::string fileName);
+//the supports of a text or binary file added straight into the matrix, without a vector of SNPSupports in between
+SupportMatrix loadSupportMatrix(std::string fileName);
+//binary if fileName ends in .bin, text otherwise
 void writeSupports(std::vector<SNPSupport> supports, std::string fileName);
+void writeSupports(const SupportMatrix& supports, std::string fileName);
 std::vector<SNPSupport> renumberSupports(std::vector<SNPSupport> supports, SupportRenumbering renumbering);
+SupportMatrix renumberSupports(const SupportMatrix& supports, const SupportRenumbering& renumbering);
 void writeRenumbering(SupportRenumbering renumbering, std::string fileName);
 SupportRenumbering loadRenumbering(std::string fileName);
 
@@ -96,7 +258,78 @@ public:
 	std::vector<SNPSupport> toSupports() const;
 };
 
+//a read's supports in a support matrix, by SNP, read through the matrix's read index without copying them
+class SNPLineView
+{
+public:
+	SNPLineView(const SupportMatrix& matrix, size_t readNum);
+	size_t size() const;
+	size_t SNP(size_t index) const;
+	char variant(size_t index) const;
+	double support(size_t index) const;
+	bool has(size_t loc) const;
+	char variantAt(size_t loc) const;
+	double supportAt(size_t loc) const;
+	//number of supports before and after loc
+	size_t countBefore(size_t loc) const;
+	size_t countAfter(size_t loc) const;
+	SNPLine toLine() const;
+	size_t readNum;
+private:
+	//index of the first support at loc or after it
+	size_t lowerBound(size_t loc) const;
+	const SupportMatrix* matrix;
+	size_t start;
+	size_t end;
+};
+
+//the lines of the reads with supports, by read. one sort of the supports
 std::vector<SNPLine> makeLines(std::vector<SNPSupport> supports);
+std::vector<SNPLine> makeLines(const SupportMatrix& supports);
+
+//first and last SNP of each read, reads without supports get {-1, 0}
+std::vector<std::pair<size_t, size_t>> getRowExtents(const std::vector<SNPSupport>& supports);
+std::vector<std::pair<size_t, size_t>> getRowExtents(const SupportMatrix& supports);
+
+//sweep line over the SNPs. a row is active from its first to its last SNP
+//the start and end events are sorted once and the active rows are updated incrementally
+class ActiveRowSweep
+{
+public:
+	ActiveRowSweep(const std::vector<std::pair<size_t, size_t>>& rowExtents, size_t numSNPs, bool trackRows);
+	ActiveRowSweep(const std::vector<SNPSupport>& supports, bool trackRows);
+	ActiveRowSweep(const SupportMatrix& supports, bool trackRows);
+	//moves to the next SNP, the first call moves to SNP 0. returns false after the last SNP
+	bool next();
+	size_t SNP() const;
+	size_t numSNPs() const;
+	size_t coverage() const;
+	//rows whose first / last SNP is the current one, sorted
+	std::vector<size_t>::const_iterator startingBegin() const;
+	std::vector<size_t>::const_iterator startingEnd() const;
+	std::vector<size_t>::const_iterator endingBegin() const;
+	std::vector<size_t>::const_iterator endingEnd() const;
+	//rows active at the current SNP, sorted. only kept up to date if trackRows was set
+	const std::vector<uint32_t>& activeRows() const;
+private:
+	void init(const std::vector<std::pair<size_t, size_t>>& rowExtents);
+	std::vector<size_t> startRows;
+	std::vector<size_t> startOffsets;
+	std::vector<size_t> endRows;
+	std::vector<size_t> endOffsets;
+	std::vector<uint32_t> active;
+	size_t currentSNP;
+	size_t SNPcount;
+	size_t currentCoverage;
+	bool trackRows;
+};
+
+//number of active rows per SNP
+std::vector<size_t> getActiveCoverage(const std::vector<SNPSupport>& supports);
+std::vector<size_t> getActiveCoverage(const SupportMatrix& supports);
+//number of different rows with a support per SNP
+std::vector<size_t> getSupportedCoverage(const std::vector<SNPSupport>& supports);
+std::vector<size_t> getSupportedCoverage(const SupportMatrix& supports);
 std::vector<SNPSupport> mergeRows(std::vector<SNPSupport> oldSupports, size_t row1, size_t row2);
 std::vector<SNPSupport> mergeRowsForceMerge(std::vector<SNPSupport> oldSupports, size_t row1, size_t row2);
 